@@ -0,0 +1,45 @@
+#ifndef LEARN_OPENGL_BOUNDS_H
+#define LEARN_OPENGL_BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <limits>
+
+using namespace glm;
+
+struct AABB {
+  vec3 min = vec3(std::numeric_limits<float>::max());
+  vec3 max = vec3(std::numeric_limits<float>::lowest());
+
+  bool empty() const;
+
+  void expand(vec3 point);
+
+  void expand(const AABB &other);
+
+  vec3 center() const;
+
+  // Bounds of the box after a transform, computed from its eight corners
+  AABB transformed(const mat4 &transform) const;
+
+  float distance_squared(vec3 point) const;
+
+  bool intersects_sphere(vec3 center, float radius) const;
+
+  // Bitmask of the cube map faces (+X, -X, +Y, -Y, +Z, -Z order) around center that the box shows up
+  // in, considering only the part of the box within radius
+  unsigned cube_faces(vec3 center, float radius) const;
+};
+
+// Planes (normal pointing inwards, distance in w) of a view-projection matrix's clip volume
+struct Frustum {
+  vec4 planes[6];
+
+  explicit Frustum(const mat4 &view_projection);
+
+  bool intersects_sphere(vec3 center, float radius) const;
+
+  bool intersects(const AABB &box) const;
+};
+
+#endif //LEARN_OPENGL_BOUNDS_H
@@ -24,6 +24,7 @@ public:
   vec3 up = vec3(0.0f, 1.0f, 0.0f);
   vec2 angles;
   float fov;
+  float near_plane = 0.1f, far_plane = 100.0f;
 
   float zoom_speed = 1.0f;
   float camera_speed = 2.5f;
@@ -0,0 +1,84 @@
+#ifndef LEARN_OPENGL_COLOR_LUT_H
+#define LEARN_OPENGL_COLOR_LUT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include <postprocess.h>
+
+// Must match shaders/common/postprocess/pointwise/lut.glsl
+#define LUT_SIZE 32
+#define LUT_MIN_EV (-10.0f)
+#define LUT_MAX_EV 8.0f
+
+using namespace glm;
+
+enum class ToneCurve {
+  None, Reinhard, Aces
+};
+
+// Applied in this order: exposure and white balance, contrast and saturation in scene linear, the tone
+// curve, then lift, gain and gamma on the display values
+struct ColorGrading {
+  ToneCurve curve = ToneCurve::Aces;
+  float exposure = 1.0f;
+  vec3 white_balance = vec3(1.0f);
+  // Around middle grey, in log space
+  float contrast = 1.0f;
+  float saturation = 1.0f;
+  vec3 lift = vec3(0.0f);
+  vec3 gain = vec3(1.0f);
+  float gamma = 1.0f;
+
+  bool operator==(const ColorGrading &other) const;
+};
+
+/*
+ * Tone curve and grading baked on the CPU into a 32^3 3D texture, so the final pass does a single
+ * trilinear fetch whatever the grading costs. The LUT is indexed by log2 of the colour relative to middle
+ * grey (LUT_MIN_EV to LUT_MAX_EV), which spreads its texels evenly over the HDR range. Its output is
+ * linear, the sRGB encoding stays with GL_FRAMEBUFFER_SRGB.
+ *
+ * Changing the grading only marks the LUT dirty, it's rebaked and uploaded by the next bind().
+ */
+class ColorLut {
+private:
+  unsigned _texture;
+  ColorGrading _grading;
+  bool dirty = true;
+  unsigned _bakes = 0;
+  double _bake_ms = 0.0;
+
+public:
+  static constexpr int texture_unit = 14;
+
+  explicit ColorLut(const ColorGrading &grading = {});
+
+  void set_grading(const ColorGrading &grading);
+
+  const ColorGrading &grading() const;
+
+  // One colour through the whole pipeline
+  static vec3 grade(const ColorGrading &grading, vec3 color);
+
+  // LUT_SIZE^3 RGB texels, red varying fastest
+  static std::vector<float> bake(const ColorGrading &grading);
+
+  // Makes the LUT the tonemapper of the chain, bind() it before every run
+  void add_to(PostProcessing &post_processing) const;
+
+  // Rebakes if the grading changed, then binds the LUT to texture_unit
+  void bind();
+
+  unsigned texture() const;
+
+  unsigned bakes() const;
+
+  double last_bake_ms() const;
+
+  void free();
+};
+
+#endif //LEARN_OPENGL_COLOR_LUT_H
@@ -0,0 +1,106 @@
+#ifndef LEARN_OPENGL_COMMAND_LIST_H
+#define LEARN_OPENGL_COMMAND_LIST_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include <framebuffer.h>
+#include <gpu_timer.h>
+#include <mesh.h>
+#include <program.h>
+
+using namespace glm;
+
+/*
+ * Compact, GL-free recording of a sequence of draws. Lists can be filled on any thread (they only
+ * store pointers and plain values), and are replayed on the GL thread. Recording never calls into GL,
+ * so anything that needs a GL query (uniform locations, block indices) is resolved at replay time.
+ *
+ * Lists that don't depend on per-frame state can be recorded once and replayed every frame.
+ */
+class CommandList {
+public:
+  enum class Op : uint8_t {
+    BindFramebuffer, Viewport, Scissor, Clear, UseProgram, BindUniformBlock, SetUniformInt, SetUniformMatrix,
+    BindTexture, SetCullFace, CullMode, Capability, ColorMask, StencilFunc, SetModelMatrix, SetInstanceRange,
+    BindMaterial, Draw, BeginQuery, EndQuery
+  };
+
+private:
+  struct Header {
+    Op op;
+    uint16_t size;
+  };
+
+  std::vector<unsigned char> buffer;
+  size_t num_commands = 0;
+
+  template<typename T>
+  void push(Op op, const T &payload);
+
+public:
+  void clear();
+
+  bool empty() const;
+
+  size_t size() const;
+
+  size_t size_bytes() const;
+
+  void bind_framebuffer(const Framebuffer &framebuffer);
+
+  void bind_default_framebuffer();
+
+  void viewport(int x, int y, int width, int height);
+
+  void scissor(int x, int y, int width, int height);
+
+  void clear_buffers(GLbitfield mask);
+
+  void use_program(const Program &program);
+
+  // Block name must outlive the list, string literals are expected here
+  void bind_uniform_block(const char *block_name, unsigned binding_point);
+
+  // Uniform name must outlive the list, same as block names
+  void set_uniform(const char *name, int value);
+
+  void set_uniform(const char *name, const mat4 &value);
+
+  void bind_texture(unsigned texture_unit, GLenum target, unsigned texture);
+
+  void set_cull_face(bool enabled);
+
+  void cull_mode(GLenum mode);
+
+  // glEnable/glDisable, for state the other commands don't cover (depth and stencil tests)
+  void set_capability(GLenum capability, bool enabled);
+
+  void color_mask(bool enabled);
+
+  void stencil_func(GLenum func, int ref, unsigned mask);
+
+  void set_model_matrix(const mat4 &transform);
+
+  // Instance range for the following draws; `first` is passed as the "instanceBase" uniform if the
+  // program declares it, since GL 3.3 has no base instance draws.
+  void set_instance_range(unsigned first, unsigned count);
+
+  void bind_material(const Mesh &mesh);
+
+  void draw(const Mesh &mesh);
+
+  // Queries must outlive the list, their results are read back by the query itself
+  void begin_query(GpuQuery &query);
+
+  void end_query(GpuQuery &query);
+
+  void replay() const;
+
+  static void replay(const std::vector<CommandList> &lists);
+};
+
+#endif //LEARN_OPENGL_COMMAND_LIST_H
@@ -0,0 +1,46 @@
+#ifndef LEARN_OPENGL_DYNAMIC_RESOLUTION_H
+#define LEARN_OPENGL_DYNAMIC_RESOLUTION_H
+
+/*
+ * Picks a render scale that holds a target GPU frame time. GPU time is assumed to grow with the pixel
+ * count, so a frame taking t ms at scale s would take target ms at about s * sqrt(target / t).
+ *
+ * Frame times are averaged over settle_frames measured frames after every change, and the scale only
+ * moves when the average leaves the band target * (1 ± hysteresis).
+ * Scales are snapped to step, so the render targets go through a handful of sizes that the pool can
+ * keep around.
+ */
+class DynamicResolution {
+private:
+  double target_ms;
+  float min_scale, max_scale, hysteresis, step;
+  float _scale;
+  unsigned settle_frames;
+  unsigned frames = 0;
+  double total_ms = 0.0;
+
+public:
+  explicit DynamicResolution(
+    double target_ms = 16.6,
+    float min_scale = 0.5f,
+    float max_scale = 1.0f,
+    float hysteresis = 0.1f,
+    float step = 0.05f,
+    unsigned settle_frames = 30
+  );
+
+  // Feeds the GPU time of a newly measured frame, once per result and only for frames rendered at the
+  // current scale; true if the scale changed
+  bool update(double gpu_ms);
+
+  float scale() const;
+
+  double target() const;
+
+  void set_target(double ms);
+
+  // Back to max_scale, discarding the frames measured so far
+  void reset();
+};
+
+#endif //LEARN_OPENGL_DYNAMIC_RESOLUTION_H
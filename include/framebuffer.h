@@ -20,20 +20,49 @@ public:
   virtual void free() = 0;
 };
 
+// Depth-stencil attachment of a TextureFramebuffer: none (post-process targets), a renderbuffer, or a
+// texture that can be sampled afterwards
+enum class DepthAttachment {
+  None, Renderbuffer, Texture
+};
+
 class TextureFramebuffer : public Framebuffer {
 private:
   std::vector<unsigned> textures;
-  unsigned _rbo;
+  unsigned _rbo, _depth;
 
 public:
-  TextureFramebuffer(int width, int height, std::vector<GLint> internal_formats);
-
-  TextureFramebuffer(int width, int height, GLint internal_format = GL_RGB16F, unsigned num_textures = 1);
+  TextureFramebuffer(
+    int width,
+    int height,
+    std::vector<GLint> internal_formats,
+    DepthAttachment depth = DepthAttachment::Renderbuffer
+  );
+
+  TextureFramebuffer(
+    int width,
+    int height,
+    GLint internal_format = GL_RGB16F,
+    unsigned num_textures = 1,
+    DepthAttachment depth = DepthAttachment::Renderbuffer
+  );
 
   unsigned texture(unsigned idx = 0) const;
 
   void bind_texture(unsigned texture_unit = 0, unsigned idx = 0) const;
 
+  unsigned depth_texture() const;
+
+  void bind_depth_texture(unsigned texture_unit) const;
+
+  void free() override;
+};
+
+// Framebuffer over textures owned elsewhere (render graph resources), free() only deletes the framebuffer
+class AttachmentFramebuffer : public Framebuffer {
+public:
+  explicit AttachmentFramebuffer(const std::vector<unsigned> &color_textures, unsigned depth_stencil_texture = 0);
+
   void free() override;
 };
 
@@ -42,7 +71,7 @@ private:
   unsigned _depth;
 
 public:
-  DepthFramebuffer(int width, int height);
+  DepthFramebuffer(int width, int height, GLint internal_format = GL_DEPTH_COMPONENT);
 
   unsigned depth_map() const;
 
@@ -61,4 +90,20 @@ public:
   void free() override;
 };
 
+// One depth texture array, rendered a layer at a time (cascades, shadow map arrays)
+class DepthArrayFramebuffer : public Framebuffer {
+private:
+  unsigned _depth;
+
+public:
+  DepthArrayFramebuffer(int width, int height, int layers, GLint internal_format = GL_DEPTH_COMPONENT);
+
+  unsigned depth_map() const;
+
+  // Binds the framebuffer with only this layer attached
+  void bind_layer(int layer) const;
+
+  void free() override;
+};
+
 #endif //LEARN_OPENGL_FRAMEBUFFER_H
@@ -0,0 +1,45 @@
+#ifndef LEARN_OPENGL_GAUSSIAN_KERNEL_H
+#define LEARN_OPENGL_GAUSSIAN_KERNEL_H
+
+#include <string>
+#include <vector>
+
+/*
+ * One side of a normalized 1D Gaussian, with neighbouring taps folded into single bilinear fetches:
+ * texels i and i + 1 weighted w1 and w2 are read as one fetch at (i * w1 + (i + 1) * w2) / (w1 + w2)
+ * weighted w1 + w2. A kernel of radius r then takes (r + 1) / 2 taps per side plus the centre, instead
+ * of r. Only exact with linear filtering.
+ *
+ * defines() emits the taps as shader constants, for Shader::fragment(path, defines):
+ *   KERNEL_TAPS, KERNEL_OFFSETS[KERNEL_TAPS] (in texels, 0 first) and KERNEL_WEIGHTS[KERNEL_TAPS]
+ * The centre tap is fetched once, every other one on both sides.
+ */
+class GaussianKernel {
+private:
+  float _sigma;
+  int _radius;
+  std::vector<float> _offsets, _weights;
+
+public:
+  GaussianKernel(float sigma, int radius);
+
+  // Radius covering 3 sigma
+  static GaussianKernel from_sigma(float sigma);
+
+  static GaussianKernel from_radius(int radius);
+
+  float sigma() const;
+
+  int radius() const;
+
+  const std::vector<float> &offsets() const;
+
+  const std::vector<float> &weights() const;
+
+  // Texture fetches for one direction, both sides
+  unsigned fetches() const;
+
+  std::string defines() const;
+};
+
+#endif //LEARN_OPENGL_GAUSSIAN_KERNEL_H
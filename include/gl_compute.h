@@ -0,0 +1,41 @@
+#ifndef LEARN_OPENGL_GL_COMPUTE_H
+#define LEARN_OPENGL_GL_COMPUTE_H
+
+#include <glad/glad.h>
+
+/*
+ * GL 4.3 compute and image entry points. glad is generated for 3.3 core, so these are loaded on their
+ * own, and only used when the context turns out to be 4.3 or newer: most drivers (Mesa included) create
+ * their newest core context when 3.3 is requested, macOS stops at 4.1.
+ */
+#ifndef GL_VERSION_4_3
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_FRAMEBUFFER_BARRIER_BIT 0x00000400
+
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void (APIENTRYP PFNGLBINDIMAGETEXTUREPROC)(
+  GLuint unit,
+  GLuint texture,
+  GLint level,
+  GLboolean layered,
+  GLint layer,
+  GLenum access,
+  GLenum format
+);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+
+extern PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute;
+extern PFNGLBINDIMAGETEXTUREPROC glad_glBindImageTexture;
+extern PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier;
+
+#define glDispatchCompute glad_glDispatchCompute
+#define glBindImageTexture glad_glBindImageTexture
+#define glMemoryBarrier glad_glMemoryBarrier
+#endif
+
+// Loads the entry points on first call, with a current context; true if compute shaders can be used
+bool load_compute_functions();
+
+#endif //LEARN_OPENGL_GL_COMPUTE_H
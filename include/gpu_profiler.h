@@ -0,0 +1,123 @@
+#ifndef LEARN_OPENGL_GPU_PROFILER_H
+#define LEARN_OPENGL_GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Rolling window of one zone's GPU times
+class ZoneStats {
+private:
+  std::string _name;
+  std::vector<double> samples;
+  size_t next = 0, window;
+  double last = 0.0;
+  uint64_t _last_frame = 0;
+
+public:
+  ZoneStats(std::string name, size_t window);
+
+  void add(double ms, uint64_t frame);
+
+  const std::string &name() const;
+
+  size_t count() const;
+
+  double last_ms() const;
+
+  // Profiler frame the last result was measured in, results arrive latency frames late and several
+  // frames can be collected at once; 0 before the first one
+  uint64_t last_frame() const;
+
+  double average_ms() const;
+
+  double min_ms() const;
+
+  double max_ms() const;
+
+  // p in [0, 1], nearest rank
+  double percentile_ms(double p) const;
+
+  void clear();
+};
+
+/*
+ * Per-zone GPU times from GL_TIMESTAMP queries. Zones may nest, each one is a pair of glQueryCounter
+ * timestamps, which unlike GL_TIME_ELAPSED queries can overlap. Every frame records into its own slot
+ * of a ring, read back once the driver reports the slot's last timestamp available, latency frames
+ * later, so nothing stalls; a frame whose slot is still in flight isn't measured.
+ */
+class GpuProfiler {
+private:
+  struct Zone {
+    size_t stats, start, end;
+  };
+
+  struct Frame {
+    uint64_t number = 0, trace_frame = 0;
+    std::vector<unsigned> queries;
+    std::vector<Zone> zones;
+    size_t used = 0;
+    bool in_flight = false;
+  };
+
+  std::vector<Frame> frames;
+  std::vector<ZoneStats> _zones;
+  std::vector<size_t> open;
+  size_t window;
+  unsigned slot = 0;
+  uint64_t frame_number = 0, cleared_frame = 0;
+  bool measuring = false;
+
+  size_t zone_index(const std::string &name);
+
+  unsigned timestamp(Frame &frame);
+
+  void collect(Frame &frame);
+
+public:
+  explicit GpuProfiler(unsigned latency = 5, size_t window = 120);
+
+  void begin_frame();
+
+  void end_frame();
+
+  // Frame begun last, counting from 1, whether it's measured or not
+  uint64_t frame() const;
+
+  void begin_zone(const std::string &name);
+
+  void end_zone();
+
+  // In the order they were first seen
+  const std::vector<ZoneStats> &zones() const;
+
+  const ZoneStats *zone(const std::string &name) const;
+
+  // Drops every zone's samples, along with the results of frames still in flight, so averages only cover
+  // frames begun afterwards (a benchmark switching modes)
+  void clear();
+
+  // One line per zone: average, min, max, 95th percentile
+  void report(std::ostream &out) const;
+
+  void free();
+};
+
+// Zone for the enclosing scope
+class GpuZone {
+private:
+  GpuProfiler &profiler;
+
+public:
+  GpuZone(GpuProfiler &profiler, const std::string &name);
+
+  GpuZone(const GpuZone &) = delete;
+
+  ~GpuZone();
+};
+
+#endif //LEARN_OPENGL_GPU_PROFILER_H
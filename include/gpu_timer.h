@@ -0,0 +1,75 @@
+#ifndef LEARN_OPENGL_GPU_TIMER_H
+#define LEARN_OPENGL_GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+/*
+ * Ring of query objects for one query target. A query is only read back once the driver reports it
+ * available, several frames after it was issued, so reading results never stalls the pipeline.
+ * Frames whose query slot is still in flight are simply not measured.
+ */
+class GpuQuery {
+private:
+  GLenum target;
+  std::vector<unsigned> queries;
+  std::vector<bool> in_flight;
+  unsigned slot = 0;
+  bool measuring = false;
+
+  void collect(unsigned idx);
+
+protected:
+  virtual void on_result(GLuint64 value) = 0;
+
+public:
+  GpuQuery(GLenum target, unsigned latency);
+
+  virtual ~GpuQuery() = default;
+
+  void begin();
+
+  void end();
+
+  void free();
+};
+
+// GL_TIME_ELAPSED
+class GpuTimer : public GpuQuery {
+private:
+  double last = 0.0, average = 0.0;
+  unsigned samples = 0;
+
+protected:
+  void on_result(GLuint64 value) override;
+
+public:
+  explicit GpuTimer(unsigned latency = 4);
+
+  // Most recent result available, in milliseconds
+  double last_ms() const;
+
+  // Exponential moving average of the results, in milliseconds
+  double average_ms() const;
+};
+
+// Counting queries, GL_PRIMITIVES_GENERATED or GL_SAMPLES_PASSED
+class GpuCounter : public GpuQuery {
+private:
+  GLuint64 last = 0;
+  double average = 0.0;
+  unsigned samples = 0;
+
+protected:
+  void on_result(GLuint64 value) override;
+
+public:
+  explicit GpuCounter(GLenum target, unsigned latency = 4);
+
+  GLuint64 last_count() const;
+
+  double average_count() const;
+};
+
+#endif //LEARN_OPENGL_GPU_TIMER_H
@@ -3,6 +3,10 @@
 
 #include <glm/glm.hpp>
 
+#include <vector>
+
+#include <bounds.h>
+#include <command_list.h>
 #include <model.h>
 #include <program.h>
 
@@ -16,11 +20,26 @@ private:
 public:
   mat4 transform = mat4(1.0);
 
+  // Indices of the lights affecting this instance, nearest first, see assign_lights()
+  std::vector<unsigned> lights;
+
   Instance(const Model &obj, const Program &program);
 
+  AABB bounds() const;
+
+  // Keeps the (at most max_lights) nearest lights whose sphere of influence overlaps the instance
+  // bounds. Lights are (position, radius) pairs; indices refer to that array.
+  void assign_lights(const std::vector<vec4> &light_spheres, unsigned max_lights);
+
   void draw(const char *model_matrix_name = "model") const;
 
   void draw_with(const Program &prog, const char *model_matrix_name = "model") const;
+
+  void draw_instanced_with(const Program &prog, unsigned count, const char *model_matrix_name = "model") const;
+
+  void record(CommandList &list) const;
+
+  void record_with(CommandList &list, const Program &prog) const;
 };
 
 #endif //LEARN_OPENGL_INSTANCE_H
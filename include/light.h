@@ -5,15 +5,50 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <bounds.h>
+#include <camera.h>
 #include <program.h>
 #include <framebuffer.h>
 
 #define SHADOW_WIDTH 1024
 #define SHADOW_HEIGHT 1024
-#define POINT_SHADOW_FAR 25.0f
+#define MAX_CASCADES 4
+// Range limits of point lights, the far plane of their shadow maps must be finite and past the near one
+#define MIN_LIGHT_RADIUS 0.5f
+#define MAX_LIGHT_RADIUS 100.0f
 
 using namespace glm;
 
+// std140 layouts of the light blocks; vec3 members are padded to vec4, so these also match the
+// texel layout used by packed light buffers (one RGBA32F texel per vec4). std140 rounds a struct up to
+// a multiple of 16 bytes, the padding keeps the UBOs sized from these at least as large as the blocks.
+struct DirectionalLightData {
+  vec4 direction, ambient, diffuse, specular;
+  mat4 light_matrix;
+  mat4 cascade_matrices[MAX_CASCADES];
+  vec4 cascade_splits;
+  int cascade_count;
+  int _pad[3];
+};
+
+static_assert(sizeof(DirectionalLightData) % 16 == 0);
+
+struct PointLightData {
+  vec4 position, ambient, diffuse, specular, attenuation;
+  mat4 light_matrices[6];
+};
+
+static_assert(sizeof(PointLightData) % 16 == 0);
+
+struct SpotLightData {
+  mat4 light_matrix;
+  vec4 position, direction, ambient, diffuse, specular, attenuation;
+  vec2 angles;
+  vec2 _pad;
+};
+
+static_assert(sizeof(SpotLightData) % 16 == 0);
+
 class Light {
 protected:
   unsigned ubo;
@@ -24,6 +59,9 @@ public:
 
   Light(unsigned binding_point, unsigned ubo_size, vec3 ambient, vec3 diffuse, vec3 specular);
 
+  // Light without its own UBO, for lights stored in a packed light buffer
+  Light(vec3 ambient, vec3 diffuse, vec3 specular);
+
   void set_ubo_binding(const Program &program, const char *block_name) const;
 
   virtual void update_ubo() const = 0;
@@ -34,7 +72,7 @@ public:
   vec3 direction;
 
   DirectionalLight(unsigned binding_point, vec3 direction, vec3 ambient, vec3 diffuse, vec3 specular)
-    : Light(binding_point, sizeof(mat4) + 4 * sizeof(vec4), ambient, diffuse, specular), direction(direction) {
+    : Light(binding_point, sizeof(DirectionalLightData), ambient, diffuse, specular), direction(direction) {
   }
 
   explicit DirectionalLight(
@@ -46,10 +84,46 @@ public:
     : DirectionalLight(binding_point, direction, color * ambient_intensity, color, color) {
   }
 
+  /*
+   * Cascaded shadow maps: the view frustum up to max_distance is split in count slices, placed between
+   * uniform and logarithmic spacing by lambda. Each cascade is an ortho projection around the bounding
+   * sphere of its slice, so its size doesn't change as the camera turns, and its origin is snapped to
+   * whole shadow map texels so it doesn't shimmer as the camera moves. Casters between the light and a
+   * cascade are kept by rendering with depth clamping. Without cascades (the default) the light uses a
+   * single fixed projection around the origin.
+   */
+  void fit_cascades(
+    const Camera &camera,
+    float aspect,
+    unsigned count,
+    int resolution,
+    float max_distance = 50.0f,
+    float lambda = 0.75f
+  );
+
+  unsigned cascades() const;
+
+  const mat4 &cascade_matrix(unsigned cascade) const;
+
+  // Whether a caster shows up in a cascade; anything in front of its near plane is clamped onto it
+  bool cascade_sees(unsigned cascade, const AABB &bounds) const;
+
   void update_ubo() const override;
+
+private:
+  unsigned cascade_count = 0;
+  mat4 cascade_matrices[MAX_CASCADES];
+  float cascade_splits[MAX_CASCADES] = {};
 };
 
 class PointLight : public Light {
+private:
+  // Shadow matrices only depend on position and radius, cache them until either changes
+  mutable mat4 light_matrices[6];
+  mutable vec3 matrices_position;
+  mutable float matrices_far = 0.0f;
+  mutable bool matrices_valid = false;
+
 public:
   vec3 position, attenuation;
 
@@ -60,7 +134,7 @@ public:
     vec3 diffuse,
     vec3 specular,
     vec3 attenuation = vec3(0.0, 0.0, 1.0))
-    : Light(binding_point, 6 * sizeof(mat4) + 5 * sizeof(vec4), ambient, diffuse, specular), position(position),
+    : Light(binding_point, sizeof(PointLightData), ambient, diffuse, specular), position(position),
       attenuation(attenuation) {
   }
 
@@ -68,6 +142,24 @@ public:
     : PointLight(binding_point, position, color * ambient_intensity, color, color) {
   }
 
+  PointLight(vec3 position, vec3 ambient, vec3 diffuse, vec3 specular, vec3 attenuation = vec3(0.0, 0.0, 1.0))
+    : Light(ambient, diffuse, specular), position(position), attenuation(attenuation) {
+  }
+
+  explicit PointLight(vec3 position, vec3 color = vec3(1.0f), float ambient_intensity = 0.1f)
+    : PointLight(position, color * ambient_intensity, color, color) {
+  }
+
+  // Distance at which the brightest channel falls below threshold: the light's range, and the far
+  // plane of its shadow map. Clamped to [MIN_LIGHT_RADIUS, MAX_LIGHT_RADIUS], a light without linear or
+  // quadratic falloff would otherwise never fade out
+  float radius(float threshold = 5.0f / 256.0f) const;
+
+  const mat4 *shadow_matrices() const;
+
+  // The radius goes in position.w
+  void pack(PointLightData &data) const;
+
   void update_ubo() const override;
 };
 
@@ -87,7 +179,7 @@ public:
     vec3 specular,
     vec3 attenuation = vec3(0.0, 0.0, 1.0)
   )
-    : Light(binding_point, sizeof(mat4) + 6 * sizeof(vec4) + 2 * sizeof(float), ambient, diffuse, specular),
+    : Light(binding_point, sizeof(SpotLightData), ambient, diffuse, specular),
       position(position),
       direction(direction),
       cos_inner_angle(cos(inner_angle)),
@@ -0,0 +1,52 @@
+#ifndef LEARN_OPENGL_LIGHT_BUFFER_H
+#define LEARN_OPENGL_LIGHT_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include <light.h>
+
+// Texels (vec4) per light in the buffer texture, see PointLightData
+#define POINT_LIGHT_TEXELS (sizeof(PointLightData) / sizeof(vec4))
+
+/*
+ * All point lights of a scene packed into a single buffer texture (samplerBuffer, RGBA32F), indexed
+ * by light in the shaders. Unlike per-light UBOs this doesn't use up uniform buffer binding points, so
+ * the number of lights is only limited by GL_MAX_TEXTURE_BUFFER_SIZE.
+ *
+ * update() repacks every light on the CPU, and uploads the range between the first and last light
+ * that actually changed in a single glBufferSubData call.
+ */
+class PointLightBuffer {
+private:
+  unsigned tbo, texture;
+  size_t capacity;
+  std::vector<PointLight> lights;
+  std::vector<PointLightData> packed;
+  size_t uploaded_bytes = 0;
+
+  void allocate(size_t new_capacity);
+
+public:
+  explicit PointLightBuffer(size_t initial_capacity = 16);
+
+  unsigned add(const PointLight &light);
+
+  PointLight &operator[](unsigned idx);
+
+  const PointLight &operator[](unsigned idx) const;
+
+  size_t size() const;
+
+  void update();
+
+  void bind(unsigned texture_unit) const;
+
+  // Bytes uploaded by the last update() call
+  size_t last_upload_bytes() const;
+
+  void free();
+};
+
+#endif //LEARN_OPENGL_LIGHT_BUFFER_H
@@ -0,0 +1,58 @@
+#ifndef LEARN_OPENGL_LIGHT_CLUSTERS_H
+#define LEARN_OPENGL_LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include <program.h>
+#include <thread_pool.h>
+
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+
+using namespace glm;
+
+/*
+ * Froxel grid over the view frustum: screen-space tiles, with depth slices spaced exponentially
+ * between the near and far planes. Each cluster gets the list of lights whose sphere of influence
+ * overlaps it, so a full-screen resolve only evaluates the lights that can actually reach a pixel.
+ *
+ * Assignment runs on the CPU, each worker owning a range of depth slices so no synchronization is
+ * needed. The result is uploaded to two buffer textures: the grid (RG32UI offset, count per cluster)
+ * and the flattened light index list (R32UI).
+ */
+class LightClusters {
+private:
+  unsigned grid_tbo, grid_texture, index_tbo, index_texture;
+  std::vector<vec4> view_lights;
+  std::vector<std::vector<unsigned>> cluster_lights;
+  std::vector<uvec2> grid;
+  std::vector<unsigned> indices;
+  float near_plane = 0.1f, far_plane = 100.0f;
+
+public:
+  LightClusters();
+
+  // Lights are (world position, radius) pairs, index order matches the light buffer
+  void build(
+    const std::vector<vec4> &lights,
+    const mat4 &view,
+    const mat4 &projection,
+    float near,
+    float far,
+    ThreadPool &pool
+  );
+
+  void bind(unsigned grid_unit, unsigned index_unit) const;
+
+  void set_uniforms(const Program &program, int screen_width, int screen_height) const;
+
+  size_t light_index_count() const;
+
+  void free();
+};
+
+#endif //LEARN_OPENGL_LIGHT_CLUSTERS_H
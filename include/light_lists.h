@@ -0,0 +1,32 @@
+#ifndef LEARN_OPENGL_LIGHT_LISTS_H
+#define LEARN_OPENGL_LIGHT_LISTS_H
+
+#include <string>
+
+#include <program.h>
+#include <shader.h>
+
+#define MAX_OBJECT_LIGHTS 8
+#define LIGHT_LIST_PERMUTATIONS 4
+
+/*
+ * Forward shading with per-object light lists: a shader source compiled with MAX_LIGHTS defined to
+ * 1, 2, 4 and 8. Each object is drawn with the smallest permutation that fits its light list, so the
+ * per-fragment loop never evaluates lights that can't reach the object. Extra defines are added to
+ * every permutation.
+ */
+class LightListPrograms {
+private:
+  Program programs[LIGHT_LIST_PERMUTATIONS];
+
+public:
+  LightListPrograms(const Shader &vertex_shader, const char *fragment_path, const std::string &defines = "");
+
+  static unsigned max_lights(unsigned permutation);
+
+  const Program &select(size_t light_count) const;
+
+  Program &operator[](unsigned permutation);
+};
+
+#endif //LEARN_OPENGL_LIGHT_LISTS_H
@@ -19,6 +19,8 @@
 
 using namespace glm;
 
+class CommandList;
+
 struct Vertex {
   vec3 position, normal, tangent;
   vec2 uv;
@@ -36,6 +38,10 @@ private:
 
   void bind_textures(const Program &program) const;
 
+  void draw_elements(unsigned instance_count) const;
+
+  friend class CommandList;
+
 public:
   Mesh(
     const std::vector<Vertex> &vertices,
@@ -57,6 +63,9 @@ public:
     unsigned uv_location = DEFAULT_UV_LOCATION
   );
 
+  // Subdivided icosahedron, scaled so its faces enclose the unit sphere (for light volumes)
+  static Mesh icosphere(unsigned subdivisions = 1);
+
   void draw(const Program &program) const;
 
   void draw_instanced(const Program &program, unsigned count) const;
@@ -7,6 +7,8 @@
 
 #include <vector>
 
+#include <bounds.h>
+#include <command_list.h>
 #include <mesh.h>
 #include <texture.h>
 
@@ -15,6 +17,7 @@ private:
   std::vector<Mesh> meshes;
   std::vector<Texture> loaded_textures;
   std::string directory;
+  AABB _bounds;
 
   bool flip_normals;
 
@@ -31,10 +34,14 @@ public:
 
   explicit Model(const std::string &file_path, bool flip_normals = false);
 
+  const AABB &bounds() const;
+
   void draw(const Program &program) const;
 
   void draw_instanced(const Program &program, unsigned count) const;
 
+  void record(CommandList &list) const;
+
   void set_instance_attribute(unsigned location, const std::vector<mat4> &data) const;
 };
 
@@ -2,45 +2,141 @@
 #define LEARN_OPENGL_POSTPROCESS_H
 
 #include <functional>
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <framebuffer.h>
+#include <gpu_timer.h>
 #include <mesh.h>
 #include <program.h>
+#include <render_target_pool.h>
 
-using PostProcessingStage = std::function<void(TextureFramebuffer &, TextureFramebuffer &, int, int, const Mesh &)>;
+// Stages read one buffer and write the other; any intermediate targets they need come from the pool
+using PostProcessingStage = std::function<
+  void(TextureFramebuffer &, TextureFramebuffer &, int, int, const Mesh &, RenderTargetPool &)
+>;
 
 PostProcessingStage make_shader_stage(const Program &program);
 
+// How a scene rendered below output resolution is brought up to it, before the final stage
+enum class Upscaler {
+  Bilinear, EdgeAware
+};
+
+/*
+ * The scene is rendered into the input target (with depth), stages then ping-pong between it and a
+ * scratch target without depth. All targets come from a pool, and resize requests are debounced, so
+ * dragging the window reallocates once when it settles rather than on every event.
+ *
+ * The input can be smaller than the output by a render scale (dynamic resolution). Stages run at the
+ * input size, the result is upscaled to the output size and the final pass (tonemapping) runs there.
+ *
+ * Pointwise stages are GLSL files defining `vec3 STAGE(vec3 color, vec2 uv)`, see shaders/common/
+ * postprocess/pointwise. Each run of consecutive pointwise stages is fused into one generated shader,
+ * one full-screen pass; a run right before the tonemapper is fused into the final pass, so it runs after
+ * upscaling. Stages in one run share a program, their uniform names must not clash.
+ */
 class PostProcessing {
 private:
   std::unique_ptr<Mesh> screen_quad;
-  std::unique_ptr<TextureFramebuffer> framebuffers[2];
-  std::vector<PostProcessingStage> stages;
-  unsigned read_fb = 0;
-  int viewport_width, viewport_height;
+  RenderTargetPool pool;
+  ResizeDebouncer resize_debouncer;
+  TextureFramebuffer *input = nullptr;
+  DepthAttachment input_depth;
+  int viewport_width, viewport_height, output_width, output_height;
+  float _render_scale = 1.0f;
+  Program bilinear_program, edge_program;
+  Upscaler _upscaler = Upscaler::EdgeAware;
+
+  // Stages as added, pointwise ones have a source path instead of a function
+  struct Stage {
+    PostProcessingStage run;
+    std::string pointwise;
+    bool analysis;
+  };
+
+  // What run() executes: fused pointwise runs, other stages by index, and the final pass
+  struct Pass {
+    const Program *program;
+    size_t stage;
+  };
+
+  std::vector<Stage> stages;
+  std::string tonemapper;
+  std::vector<Pass> plan;
+  const Program *final_program = nullptr;
+  std::map<std::string, Program> fused_programs;
+  std::map<std::string, int> samplers;
+  bool plan_dirty = true;
+  GpuCounter primitives;
+
+  void apply_pending_resize();
+
+  void allocate_input();
+
+  const Program &fused_program(const std::vector<std::string> &sources);
+
+  void build_plan();
+
+public:
+  // The tonemapper is a pointwise stage source, applied last. Without an input depth attachment the scene
+  // is expected to render to input_texture() with its own depth.
+  PostProcessing(
+    int width,
+    int height,
+    const std::string &tonemapper,
+    DepthAttachment input_depth = DepthAttachment::Renderbuffer
+  );
+
+  void set_tonemapper(const std::string &source);
+
+  // Sets the output size and reallocates the input right away
+  void resize_framebuffers(int width, int height);
 
-  TextureFramebuffer &read_buffer() const;
+  // Input size relative to the output, reallocates the input when its size changes
+  void set_render_scale(float scale);
 
-  TextureFramebuffer &write_buffer() const;
+  float render_scale() const;
 
-  void swap_buffers();
+  int render_width() const;
 
-public:
-  Program &final_stage;
+  int render_height() const;
 
-  PostProcessing(int width, int height, Program &final_stage);
+  void set_upscaler(Upscaler upscaler);
 
-  void resize_framebuffers(int width, int height);
+  Upscaler upscaler() const;
+
+  // Reallocates once a burst of requests has settled, for window resize events
+  void request_resize(int width, int height);
 
-  unsigned input_framebuffer() const;
+  unsigned input_framebuffer();
 
-  void bind_input_framebuffer() const;
+  unsigned input_texture();
+
+  void bind_input_framebuffer();
+
+  const RenderTargetPool &targets() const;
 
   void run();
 
   void add_stage(const PostProcessingStage &stage);
+
+  // Only reads the image (measurements), which passes on unchanged; its write buffer is scratch
+  void add_analysis_stage(const PostProcessingStage &stage);
+
+  void add_pointwise_stage(const std::string &source);
+
+  // Texture unit of a sampler pointwise stages declare, set on every fused program. Whoever owns the
+  // texture binds it there before run().
+  void set_sampler(const std::string &name, int texture_unit);
+
+  // Every program a pointwise stage runs in, for setting its uniforms
+  std::vector<const Program *> pointwise_programs(const std::string &source);
+
+  // Full-screen passes per frame, counted by the GPU (two triangles each) a few frames behind
+  double fullscreen_passes() const;
 };
 
 #endif // LEARN_OPENGL_POSTPROCESS_H
@@ -0,0 +1,58 @@
+#ifndef LEARN_OPENGL_AUTO_EXPOSURE_H
+#define LEARN_OPENGL_AUTO_EXPOSURE_H
+
+#include <chrono>
+
+#include <framebuffer.h>
+#include <mesh.h>
+#include <postprocess.h>
+#include <program.h>
+#include <render_target_pool.h>
+
+#define LUMINANCE_SIZE 256
+
+/*
+ * Exposure from the scene's average luminance, entirely on the GPU. Each frame the image is reduced to
+ * log luminance in a 256x256 target whose mipmaps average it down to one texel, then a 1x1 pass eases
+ * the adapted luminance towards it and derives the exposure. The result stays in a 1x1 texture bound to
+ * texture_unit, where the auto_exposure pointwise stage reads it; nothing is read back.
+ *
+ * add_to() registers the measurement as an analysis stage followed by the pointwise stage applying it,
+ * which fuses with the pointwise stages after it. The stage is referenced, it must outlive the chain.
+ */
+class PostProcessAutoExposure {
+private:
+  Program luminance_program, adapt_program;
+  TextureFramebuffer luminance;
+  TextureFramebuffer adapted[2];
+  unsigned current = 0;
+  float speed;
+  bool first_run = true;
+  std::chrono::steady_clock::time_point last_run;
+
+public:
+  static constexpr int texture_unit = 15;
+
+  // Key is the exposed average luminance, speed how fast adaptation converges, per second
+  explicit PostProcessAutoExposure(float key = 0.18f, float speed = 1.5f);
+
+  void set_key(float key);
+
+  void add_to(PostProcessing &post_processing);
+
+  // 1x1, adapted luminance in R and exposure in G
+  unsigned exposure_texture() const;
+
+  void operator()(
+    TextureFramebuffer &read_buffer,
+    TextureFramebuffer &write_buffer,
+    int viewport_width,
+    int viewport_height,
+    const Mesh &screen_quad,
+    RenderTargetPool &pool
+  );
+
+  void free();
+};
+
+#endif //LEARN_OPENGL_AUTO_EXPOSURE_H
@@ -1,26 +1,88 @@
 #ifndef LEARN_OPENGL_BLOOM_H
 #define LEARN_OPENGL_BLOOM_H
 
+#include <memory>
+
 #include <framebuffer.h>
+#include <gpu_profiler.h>
 #include <mesh.h>
 #include <program.h>
+#include <render_target_pool.h>
+
+enum class BloomMode {
+  // Threshold at full resolution, then iterations of separable 9-tap blur, also at full resolution
+  Blur,
+  // Thresholded 13-tap downsample into a chain of half resolution mips, tent upsample back up
+  MipChain
+};
+
+// How BloomMode::Blur blurs: two fragment passes per iteration, or one compute dispatch per iteration
+// that blurs both directions in shared memory (GL 4.3, falls back to fragment passes without it)
+enum class BlurBackend {
+  Fragment, Compute
+};
 
 class PostProcessBloom {
 private:
-  Program bloom_program, blur_program_h, blur_program_v, add_program;
-  TextureFramebuffer internal_buffer;
-  int width, height;
-  unsigned iterations;
+  Program bloom_program, blur_program_h, blur_program_v, add_program, down_program, up_program;
+  Program blur_compute_program;
+  unsigned mips, iterations;
+  BloomMode _mode = BloomMode::MipChain;
+  BlurBackend _backend = BlurBackend::Fragment;
+  bool _compute_supported = false;
+  GpuProfiler *profiler = nullptr;
+
+  void blur(
+    TextureFramebuffer &read_buffer,
+    TextureFramebuffer &write_buffer,
+    int viewport_width,
+    int viewport_height,
+    const Mesh &screen_quad,
+    RenderTargetPool &pool
+  );
+
+  // Blurs buffer, ping-ponging with scratch, and returns the one holding the result
+  TextureFramebuffer &compute_blur(
+    TextureFramebuffer &buffer,
+    TextureFramebuffer &scratch,
+    int viewport_width,
+    int viewport_height
+  );
+
+  void mip_chain(
+    TextureFramebuffer &read_buffer,
+    TextureFramebuffer &write_buffer,
+    int viewport_width,
+    int viewport_height,
+    const Mesh &screen_quad,
+    RenderTargetPool &pool
+  );
 
 public:
-  PostProcessBloom(int width, int height, unsigned iterations = 1);
+  // Mip count for the mip chain, blur iterations for the full resolution blur
+  explicit PostProcessBloom(unsigned mips = 6, unsigned iterations = 5);
+
+  void set_mode(BloomMode mode);
+
+  BloomMode mode() const;
+
+  // Compute is ignored when unsupported, backend() then stays Fragment
+  void set_backend(BlurBackend backend);
+
+  BlurBackend backend() const;
+
+  bool compute_supported() const;
+
+  // Times the whole stage as a "bloom" zone, nullptr to stop
+  void set_profiler(GpuProfiler *gpu_profiler);
 
   void operator()(
     TextureFramebuffer &read_buffer,
     TextureFramebuffer &write_buffer,
     int viewport_width,
     int viewport_height,
-    const Mesh &screen_quad
+    const Mesh &screen_quad,
+    RenderTargetPool &pool
   );
 };
 
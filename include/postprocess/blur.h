@@ -0,0 +1,28 @@
+#ifndef LEARN_OPENGL_BLUR_H
+#define LEARN_OPENGL_BLUR_H
+
+#include <framebuffer.h>
+#include <gaussian_kernel.h>
+#include <mesh.h>
+#include <program.h>
+#include <render_target_pool.h>
+
+// Separable Gaussian blur stage, horizontal into a pooled target then vertical into the write buffer
+class PostProcessBlur {
+private:
+  Program blur_program_h, blur_program_v;
+
+public:
+  explicit PostProcessBlur(const GaussianKernel &kernel = GaussianKernel::from_radius(4));
+
+  void operator()(
+    TextureFramebuffer &read_buffer,
+    TextureFramebuffer &write_buffer,
+    int viewport_width,
+    int viewport_height,
+    const Mesh &screen_quad,
+    RenderTargetPool &pool
+  );
+};
+
+#endif //LEARN_OPENGL_BLUR_H
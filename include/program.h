@@ -24,6 +24,8 @@ public:
 
   Program(const char *vertex_src, const char *fragment_src);
 
+  explicit Program(const Shader &compute_shader);
+
   void attach_shader(const Shader &shader) const;
 
   void link();
@@ -46,6 +48,8 @@ public:
 
   void set(const char *name, vec3 value) const;
 
+  void set(const char *name, const int *values, int count) const;
+
   void set_matrix(const char *name, mat4 &mat) const;
 
   void bind_uniform_block(const char *name, unsigned value) const;
@@ -0,0 +1,157 @@
+#ifndef LEARN_OPENGL_RENDER_GRAPH_H
+#define LEARN_OPENGL_RENDER_GRAPH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <framebuffer.h>
+#include <gpu_profiler.h>
+#include <render_target_pool.h>
+
+using namespace glm;
+
+class RenderGraph;
+
+using RenderResource = unsigned;
+
+using RenderPassFunction = std::function<void(const RenderGraph &)>;
+
+/*
+ * Declarative description of a frame. Passes declare the textures they sample, the attachments they
+ * render to and any other resources they write (targets they bind themselves); compile() then
+ *  - orders them: writers of a resource run in declaration order, passes that only read it run after
+ *    the last write,
+ *  - culls passes whose outputs nothing reads, unless they draw to the screen or write an imported
+ *    resource,
+ *  - places transient textures whose lifetimes don't overlap in the same memory, from a pool kept
+ *    across compiles,
+ *  - builds one framebuffer per pass over its attachments, so passes share depth instead of blitting
+ *    it. A pass that samples the depth it also has attached gets a copy made right before it runs.
+ *
+ * The graph is rebuilt when the frame changes shape (resize, toggles) and executed every frame.
+ */
+class RenderGraph {
+public:
+  static constexpr RenderResource none = ~0u;
+
+  class PassBuilder {
+  private:
+    RenderGraph &graph;
+    unsigned pass;
+
+  public:
+    PassBuilder(RenderGraph &graph, unsigned pass);
+
+    PassBuilder &read(RenderResource resource);
+
+    // Written without being attached, the pass binds its own target
+    PassBuilder &write(RenderResource resource);
+
+    PassBuilder &color(RenderResource resource);
+
+    PassBuilder &depth(RenderResource resource);
+
+    // Attachments cleared here don't keep the passes that wrote them before
+    PassBuilder &clear(GLbitfield mask, vec4 color = vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    // Renders to the default framebuffer, never culled
+    PassBuilder &to_screen();
+  };
+
+private:
+  struct Resource {
+    std::string name;
+    RenderTargetDesc desc;
+    bool imported;
+    unsigned texture;
+    int slot;
+  };
+
+  struct Pass {
+    std::string name;
+    RenderPassFunction execute;
+    std::vector<RenderResource> reads, writes, colors;
+    RenderResource depth = none;
+    GLbitfield clear_mask = 0;
+    vec4 clear_color;
+    bool to_screen = false;
+  };
+
+  struct CompiledPass {
+    unsigned pass;
+    std::unique_ptr<AttachmentFramebuffer> framebuffer;
+    int width = 0, height = 0;
+    int depth_copy = -1;
+  };
+
+  std::vector<Resource> resources;
+  std::vector<Pass> passes;
+
+  std::vector<CompiledPass> compiled;
+  std::vector<TextureFramebuffer *> slots;
+  std::vector<RenderTargetDesc> slot_descs;
+  RenderTargetPool pool;
+  const CompiledPass *current = nullptr;
+  GpuProfiler *profiler = nullptr;
+
+  RenderResource add_resource(const std::string &name, const RenderTargetDesc &desc, bool imported, unsigned texture);
+
+  std::vector<RenderResource> inputs(const Pass &pass) const;
+
+  std::vector<RenderResource> outputs(const Pass &pass) const;
+
+  bool overwrites(const Pass &pass, RenderResource resource) const;
+
+  std::vector<unsigned> sort_passes() const;
+
+  int take_slot(const RenderTargetDesc &desc, std::vector<int> &free_slots);
+
+  void release_compiled();
+
+public:
+  // Transient textures, allocated by the graph
+  RenderResource create_texture(const std::string &name, int width, int height, GLint internal_format);
+
+  RenderResource create_depth(const std::string &name, int width, int height);
+
+  // Textures owned elsewhere, e.g. the post-processing input, kept alive and never aliased
+  RenderResource import_texture(const std::string &name, unsigned texture, int width, int height);
+
+  PassBuilder add_pass(const std::string &name, const RenderPassFunction &execute);
+
+  // Drops every pass and resource, transient textures go back to the pool for the next compile
+  void reset();
+
+  void compile();
+
+  void execute();
+
+  // Times every executed pass as a zone named after it, nullptr to stop
+  void set_profiler(GpuProfiler *gpu_profiler);
+
+  // Texture behind a resource, valid while executing
+  unsigned texture(RenderResource resource) const;
+
+  void bind_texture(RenderResource resource, unsigned texture_unit) const;
+
+  size_t pass_count() const;
+
+  size_t culled_count() const;
+
+  size_t transient_count() const;
+
+  // Textures actually allocated for the transient resources, after aliasing
+  size_t texture_count() const;
+
+  size_t memory_bytes() const;
+
+  void free();
+};
+
+#endif //LEARN_OPENGL_RENDER_GRAPH_H
@@ -0,0 +1,58 @@
+#ifndef LEARN_OPENGL_RENDER_STATS_H
+#define LEARN_OPENGL_RENDER_STATS_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// What one frame asked of GL, counted by the wrappers (Mesh, Program, Texture, framebuffers, command
+// lists, lights, the render graph); raw GL calls made directly by a demo aren't included
+struct RenderCounters {
+  uint64_t draw_calls = 0, instanced_draws = 0, primitives = 0;
+  uint64_t program_binds = 0, texture_binds = 0, vao_binds = 0, framebuffer_binds = 0;
+  uint64_t uniform_calls = 0, buffer_uploads = 0, upload_bytes = 0, clears = 0;
+
+  RenderCounters &operator+=(const RenderCounters &other);
+};
+
+/*
+ * Per-frame counters. GL only runs on the main thread, so they are plain integers; end_frame() (called
+ * by Window) moves the frame in progress to last_frame().
+ */
+class RenderStats {
+private:
+  static inline RenderCounters _current, _last;
+
+public:
+  static RenderCounters &current() {
+    return _current;
+  }
+
+  static const RenderCounters &last_frame();
+
+  static void end_frame();
+
+  static void draw(uint64_t primitives, uint64_t instances);
+
+  static void upload(uint64_t bytes);
+};
+
+// Appends a CSV row every interval frames: the frame number and each counter averaged over the interval
+class RenderStatsLog {
+private:
+  std::ofstream out;
+  unsigned interval = 0, frames = 0, frame_number = 0;
+  RenderCounters total;
+
+public:
+  // Truncates the file and writes the header, interval 0 stops logging
+  void open(const std::string &path, unsigned every_frames);
+
+  void close();
+
+  bool is_open() const;
+
+  void add_frame(const RenderCounters &counters);
+};
+
+#endif //LEARN_OPENGL_RENDER_STATS_H
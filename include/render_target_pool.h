@@ -0,0 +1,80 @@
+#ifndef LEARN_OPENGL_RENDER_TARGET_POOL_H
+#define LEARN_OPENGL_RENDER_TARGET_POOL_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <framebuffer.h>
+
+struct RenderTargetDesc {
+  int width, height;
+  std::vector<GLint> formats;
+  DepthAttachment depth = DepthAttachment::None;
+
+  bool operator==(const RenderTargetDesc &other) const;
+
+  size_t bytes() const;
+};
+
+/*
+ * Render targets shared between passes and frames. acquire() hands out a free target with a matching
+ * size, formats and depth attachment, or allocates one; release() returns it to the pool. Targets left
+ * unused for max_idle_frames frames are freed in end_frame(), so sizes that stop being requested (after
+ * a resize) don't linger, while toggling back and forth between sizes or layouts doesn't reallocate.
+ */
+class RenderTargetPool {
+private:
+  struct Entry {
+    RenderTargetDesc desc;
+    std::unique_ptr<TextureFramebuffer> target;
+    bool in_use;
+    unsigned last_used;
+  };
+
+  std::vector<Entry> entries;
+  unsigned frame = 0, max_idle_frames;
+  unsigned _allocations = 0;
+
+public:
+  explicit RenderTargetPool(unsigned max_idle_frames = 120);
+
+  TextureFramebuffer &acquire(const RenderTargetDesc &desc);
+
+  void release(const TextureFramebuffer &target);
+
+  void end_frame();
+
+  // Targets currently allocated, in use or not
+  size_t size() const;
+
+  size_t memory_bytes() const;
+
+  // Number of allocations made so far
+  unsigned allocations() const;
+
+  void free();
+};
+
+// Coalesces a burst of resize events (dragging a window edge) into a single size, reported once no new
+// event has arrived for delay_ms
+class ResizeDebouncer {
+private:
+  int width = 0, height = 0;
+  bool pending = false;
+  double delay_ms;
+  std::chrono::steady_clock::time_point last_event;
+
+public:
+  explicit ResizeDebouncer(double delay_ms = 150.0);
+
+  void request(int new_width, int new_height);
+
+  // True once per burst, when it has settled; the final size is written to width and height
+  bool poll(int &out_width, int &out_height);
+};
+
+#endif //LEARN_OPENGL_RENDER_TARGET_POOL_H
@@ -17,7 +17,8 @@ private:
   std::string get_type() const;
 
 public:
-  Shader(GLenum type, const char *src_path);
+  // Defines are inserted right after the #version line, to compile permutations of the same source
+  Shader(GLenum type, const char *src_path, const std::string &defines = "");
 
   ~Shader();
 
@@ -27,6 +28,14 @@ public:
 
   static Shader fragment(const char *src_path);
 
+  static Shader fragment(const char *src_path, const std::string &defines);
+
+  // GL 4.3, see gl_compute.h
+  static Shader compute(const char *src_path, const std::string &defines = "");
+
+  // File contents, or an empty string if it can't be read
+  static std::string read_source(const char *src_path);
+
   unsigned id() const;
 
   GLenum type() const;
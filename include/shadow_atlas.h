@@ -0,0 +1,139 @@
+#ifndef LEARN_OPENGL_SHADOW_ATLAS_H
+#define LEARN_OPENGL_SHADOW_ATLAS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <climits>
+#include <vector>
+
+#include <bounds.h>
+#include <framebuffer.h>
+
+// Tile rects stored per slot in the rect buffer, one per cube face (spot lights only use the first)
+#define SHADOW_SLOT_FACES 6
+
+using namespace glm;
+
+// What a tile needs this frame: nothing, dynamic casters over the cached static layer, or everything
+enum class ShadowPass {
+  Cached, Dynamic, Full
+};
+
+struct ShadowRequest {
+  unsigned slot;
+  unsigned faces;
+  int resolution;
+  vec4 sphere;          // Light position and radius, the cached map is reused while these don't change
+  bool dynamic_casters; // Whether any moving caster is within the light's radius
+  float importance;     // Scheduling priority when over the face budget, e.g. screen size
+};
+
+struct ShadowTile {
+  unsigned slot, face;
+  ivec2 offset;
+  int size;
+  ShadowPass pass;
+  bool dynamic_casters;
+};
+
+/*
+ * Shadow maps for many lights packed into a single 2D depth texture. Each frame lights request a
+ * number of square tiles (6 for a point light, 1 for a spot light) at a power of two resolution, and
+ * the atlas hands out regions for as many as fit, halving the largest requests when over budget.
+ *
+ * Tiles are placed along a Z-order curve, largest first: every tile then starts at an offset aligned
+ * to its own size, so packing is exact and needs no free lists. The normalized rect of each tile is
+ * uploaded to a buffer texture (RGBA32F), SHADOW_SLOT_FACES texels per slot; slots without a shadow
+ * get an empty rect.
+ *
+ * Maps are cached between frames. A slot keeps its contents while its tile, light position and radius
+ * stay the same and no static caster in range is invalidated. With the static cache enabled, static
+ * casters are rendered into a second atlas of the same layout, and tiles with moving casters in range
+ * start each frame from a copy of it instead of redrawing everything; the frame after the last one
+ * leaves, the copy alone erases its shadow. A frame is rendered as:
+ *   1. Full tiles: clear and draw static casters into static_target()
+ *   2. restore_static()
+ *   3. Full and Dynamic tiles with dynamic casters: draw dynamic casters into target()
+ *
+ * Updates can be time sliced with a budget of faces per frame. Faces whose tile just moved are always
+ * drawn; stale faces are ranked by importance times the number of frames they have been waiting, and
+ * those over budget are left as they are (pass Cached) until a later frame.
+ */
+class ShadowAtlas {
+private:
+  struct CachedSlot {
+    vec4 sphere;
+    ivec2 offset;
+    int resolution = 0;
+    bool valid = false;
+  };
+
+  // Light sphere a face was last drawn with, frames since, and whether dynamic casters were drawn into it
+  struct CachedFace {
+    vec4 sphere;
+    unsigned age = 0;
+    bool dirty = true;
+    bool had_dynamic = false;
+  };
+
+  DepthFramebuffer framebuffer, static_framebuffer;
+  int _size, min_tile, max_tile;
+  GLint depth_format;
+  bool static_cache;
+  unsigned rect_tbo, rect_texture;
+  std::vector<vec4> rects;
+  std::vector<ShadowTile> _tiles;
+  std::vector<CachedSlot> cache;
+  std::vector<CachedFace> faces;
+  unsigned _rendered_maps = 0, _rendered_faces = 0;
+
+public:
+  explicit ShadowAtlas(
+    int size = 4096,
+    GLint depth_format = GL_DEPTH_COMPONENT16,
+    bool static_cache = true,
+    int min_tile = 64,
+    int max_tile = 1024
+  );
+
+  // Tile resolution for a light covering this many pixels on screen
+  int resolution_for(float screen_size) const;
+
+  // Static casters that moved must be reported before allocate(), any slot they reach is redrawn
+  void invalidate(const AABB &caster_bounds);
+
+  void invalidate_all();
+
+  void allocate(std::vector<ShadowRequest> requests, unsigned num_slots, unsigned face_budget = UINT_MAX);
+
+  const std::vector<ShadowTile> &tiles() const;
+
+  // Number of shadow maps (slots) redrawn this frame, either fully or just their dynamic casters
+  unsigned rendered_maps() const;
+
+  unsigned rendered_faces() const;
+
+  int size() const;
+
+  const Framebuffer &target() const;
+
+  unsigned depth_map() const;
+
+  // Where static casters are drawn, the atlas itself when the static cache is disabled
+  const Framebuffer &static_target() const;
+
+  // Copies the static layer into every tile redrawn this frame
+  void restore_static() const;
+
+  // Enables depth comparison and bilinear filtering on the atlas, for sampler2DShadow lookups
+  void set_compare(bool enabled) const;
+
+  void bind(unsigned atlas_unit, unsigned rect_unit) const;
+
+  size_t memory_bytes() const;
+
+  void free();
+};
+
+#endif //LEARN_OPENGL_SHADOW_ATLAS_H
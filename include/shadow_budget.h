@@ -0,0 +1,32 @@
+#ifndef LEARN_OPENGL_SHADOW_BUDGET_H
+#define LEARN_OPENGL_SHADOW_BUDGET_H
+
+/*
+ * Per-frame limit on shadow map updates, as a number of cube faces for ShadowAtlas::allocate(). A
+ * budget in milliseconds is turned into faces using the measured GPU time of the shadow pass, divided
+ * by the faces it drew; while nothing has been measured yet, min_faces are allowed. The time comes from
+ * the profiler zone around the pass, fed once per result.
+ */
+class ShadowBudget {
+private:
+  unsigned max_faces, min_faces;
+  double max_ms;
+  double average_ms = 0.0, average_faces = 0.0;
+
+  ShadowBudget(unsigned max_faces, unsigned min_faces, double max_ms);
+
+public:
+  static ShadowBudget faces(unsigned count);
+
+  static ShadowBudget milliseconds(double ms, unsigned min_faces = 6);
+
+  unsigned face_budget() const;
+
+  // Faces the shadow pass actually drew this frame
+  void add_faces(unsigned faces);
+
+  // GPU time of a measured shadow pass
+  void add_time(double gpu_ms);
+};
+
+#endif //LEARN_OPENGL_SHADOW_BUDGET_H
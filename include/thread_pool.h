@@ -0,0 +1,44 @@
+#ifndef LEARN_OPENGL_THREAD_POOL_H
+#define LEARN_OPENGL_THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Small fixed-size pool for CPU-side frame work (draw recording, culling, light assignment).
+ * The calling thread always takes part as worker 0, so a pool of size 1 spawns no threads at all.
+ * None of the jobs may touch GL: the context is only current on the main thread.
+ */
+class ThreadPool {
+private:
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable job_ready, job_done;
+  std::function<void(unsigned)> job;
+  unsigned generation = 0, pending = 0;
+  bool stopping = false;
+
+  void worker_loop(unsigned worker);
+
+public:
+  explicit ThreadPool(unsigned num_threads = std::thread::hardware_concurrency());
+
+  ThreadPool(const ThreadPool &) = delete;
+
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool();
+
+  unsigned size() const;
+
+  // Runs fn(worker) once on every worker, returns when all of them are done
+  void run(const std::function<void(unsigned)> &fn);
+
+  // Splits [0, count) into size() contiguous ranges, worker i always gets the i-th range
+  void parallel_for(size_t count, const std::function<void(size_t, size_t, unsigned)> &fn);
+};
+
+#endif //LEARN_OPENGL_THREAD_POOL_H
@@ -0,0 +1,76 @@
+#ifndef LEARN_OPENGL_TRACE_H
+#define LEARN_OPENGL_TRACE_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/*
+ * CPU zones and GPU pass timings on one timeline, written as Chrome Trace Event JSON (chrome://tracing,
+ * Perfetto). Trace::capture(n) records the next n frames and writes the file once the GPU timings of
+ * those frames have come back.
+ *
+ * Outside a capture a zone costs one relaxed atomic load; defining LEARN_OPENGL_NO_TRACE compiles zones
+ * out entirely. Each thread appends to its own buffer without locking. Captures start and stop at frame
+ * boundaries (Trace::frame(), called by Window), while pool workers are idle between jobs. Window also
+ * marks a boundary before setup(), so a capture requested by then (LEARN_OPENGL_TRACE_STARTUP=frames)
+ * records loading as frame 0.
+ */
+#ifndef LEARN_OPENGL_NO_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// name must outlive the capture, a string literal
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#else
+#define TRACE_ZONE(name) ((void) 0)
+#endif
+
+class Trace {
+private:
+  static inline std::atomic<bool> capturing = false, collecting_gpu = false;
+
+public:
+  static bool active() {
+    return capturing.load(std::memory_order_relaxed);
+  }
+
+  // Records the next frames frames into path, unless a capture is already running
+  static void capture(unsigned frames, const std::string &path = "trace.json");
+
+  // Frame boundary, starts, stops and writes captures
+  static void frame();
+
+  // Number of the frame begun by the last frame() call, main thread only
+  static uint64_t frame_index();
+
+  // Shown instead of the thread's number
+  static void set_thread_name(const std::string &name);
+
+  static int64_t now_ns();
+
+  static void cpu_event(const char *name, int64_t start_ns, int64_t end_ns);
+
+  // Timestamps from GL_TIMESTAMP queries, mapped onto the CPU clock. frame is the frame_index() the work
+  // was submitted in: it finishes after that frame's CPU end, so events are kept by frame, not by time.
+  static void gpu_event(const std::string &name, uint64_t frame, GLuint64 start, GLuint64 end);
+};
+
+class TraceZone {
+private:
+  const char *name;
+  int64_t start_ns;
+
+public:
+  explicit TraceZone(const char *name) : name(name), start_ns(Trace::active() ? Trace::now_ns() : -1) {
+  }
+
+  TraceZone(const TraceZone &) = delete;
+
+  ~TraceZone() {
+    if (start_ns >= 0) Trace::cpu_event(name, start_ns, Trace::now_ns());
+  }
+};
+
+#endif //LEARN_OPENGL_TRACE_H
@@ -7,6 +7,10 @@
 #include <iostream>
 
 #include <camera.h>
+#include <gpu_profiler.h>
+#include <render_stats.h>
+#include <thread_pool.h>
+#include <trace.h>
 #include <memory>
 
 GLFWwindow *init_window(int initial_width, int initial_height, const char *title);
@@ -18,6 +22,12 @@ private:
 protected:
   GLFWwindow *glfw_window;
   std::unique_ptr<Camera> camera;
+  std::unique_ptr<ThreadPool> thread_pool;
+  // Frames are bracketed by start(), demos add zones; reported every gpu_profile_interval frames if set
+  std::unique_ptr<GpuProfiler> gpu_profiler;
+  unsigned gpu_profile_interval = 0;
+  // Fed the counters of every frame, writes nothing until opened
+  RenderStatsLog render_stats_log;
 
   float current_frame = 0.0f, delta_time = 0.0f;
   int viewport_width = -1, viewport_height = -1;
@@ -31,6 +41,9 @@ public:
 
   float aspect_ratio() const;
 
+  // Counters of the last finished frame
+  const RenderCounters &render_stats() const;
+
   virtual void setup() = 0;
 
   virtual void frame() = 0;
@@ -0,0 +1,60 @@
+#version 430 core
+// KERNEL_TAPS, KERNEL_OFFSETS, KERNEL_WEIGHTS and APRON (the kernel radius) come from the defines
+#define TILE 16
+#define SIDE (TILE + 2 * APRON)
+
+layout(local_size_x = TILE, local_size_y = TILE) in;
+
+uniform sampler2D screenTexture;
+layout(rgba16f, binding = 0) uniform writeonly image2D outputImage;
+
+// The tile with its apron, then the same rows blurred horizontally over the tile's columns
+shared vec3 texels[SIDE][SIDE];
+shared vec3 rows[SIDE][TILE];
+
+// Kernel offsets fall between texels, blended like bilinear filtering would
+vec3 texelAt(int y, float x) {
+    int i = int(floor(x));
+    return mix(texels[y][i], texels[y][min(i + 1, SIDE - 1)], x - float(i));
+}
+
+vec3 rowAt(float y, int x) {
+    int i = int(floor(y));
+    return mix(rows[i][x], rows[min(i + 1, SIDE - 1)][x], y - float(i));
+}
+
+void main() {
+    ivec2 size = textureSize(screenTexture, 0);
+    ivec2 origin = ivec2(gl_WorkGroupID.xy) * TILE - APRON;
+    int local = int(gl_LocalInvocationIndex);
+
+    for (int i = local; i < SIDE * SIDE; i += TILE * TILE) {
+        ivec2 p = ivec2(i % SIDE, i / SIDE);
+        texels[p.y][p.x] = texelFetch(screenTexture, clamp(origin + p, ivec2(0), size - 1), 0).rgb;
+    }
+    barrier();
+
+    for (int i = local; i < SIDE * TILE; i += TILE * TILE) {
+        int y = i / TILE, x = i % TILE;
+        float centre = float(x + APRON);
+        vec3 sum = texels[y][x + APRON] * KERNEL_WEIGHTS[0];
+        for (int t = 1; t < KERNEL_TAPS; t++) {
+            vec3 taps = texelAt(y, centre + KERNEL_OFFSETS[t]) + texelAt(y, centre - KERNEL_OFFSETS[t]);
+            sum += taps * KERNEL_WEIGHTS[t];
+        }
+        rows[y][x] = sum;
+    }
+    barrier();
+
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    if (pixel.x >= size.x || pixel.y >= size.y) return;
+
+    ivec2 p = ivec2(gl_LocalInvocationID.xy);
+    float centre = float(p.y + APRON);
+    vec3 sum = rows[p.y + APRON][p.x] * KERNEL_WEIGHTS[0];
+    for (int t = 1; t < KERNEL_TAPS; t++) {
+        vec3 taps = rowAt(centre + KERNEL_OFFSETS[t], p.x) + rowAt(centre - KERNEL_OFFSETS[t], p.x);
+        sum += taps * KERNEL_WEIGHTS[t];
+    }
+    imageStore(outputImage, pixel, vec4(sum, 1.0));
+}
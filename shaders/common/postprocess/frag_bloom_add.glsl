@@ -5,12 +5,11 @@ in vec2 texCoord;
 
 uniform sampler2D screenTexture;
 uniform sampler2D bloomTexture;
-
-#define BLOOM_STRENGTH 0.5
+uniform float bloomStrength = 0.5;
 
 void main() {
     vec3 color = vec3(texture(screenTexture, texCoord));
-    color += vec3(texture(bloomTexture, texCoord)) * BLOOM_STRENGTH;
+    color += vec3(texture(bloomTexture, texCoord)) * bloomStrength;
 
     FragColor = vec4(color, 1.0);
 }
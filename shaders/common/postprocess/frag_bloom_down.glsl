@@ -0,0 +1,65 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 texCoord;
+
+uniform sampler2D screenTexture;
+uniform int prefilter = 0;
+uniform float threshold = 1.0;
+uniform float knee = 0.5;
+
+float luma(vec3 color) {
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Soft threshold: a quadratic ramp from threshold - knee up to threshold, linear above
+vec3 applyThreshold(vec3 color) {
+    float brightness = max(color.r, max(color.g, color.b));
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-4);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 1e-4);
+    return color * contribution;
+}
+
+// Karis average: weights each group by inverse luma, so single very bright pixels don't flicker
+vec3 karisAverage(vec3 a, vec3 b, vec3 c, vec3 d) {
+    float wa = 1.0 / (1.0 + luma(a)), wb = 1.0 / (1.0 + luma(b));
+    float wc = 1.0 / (1.0 + luma(c)), wd = 1.0 / (1.0 + luma(d));
+    return (a * wa + b * wb + c * wc + d * wd) / (wa + wb + wc + wd);
+}
+
+// 13-tap downsample (Jimenez, "Next generation post processing in Call of Duty: Advanced Warfare"): five
+// overlapping 2x2 boxes, the centre one weighted 0.5 and the corners 0.125. The first pass out of the
+// full resolution image also applies the threshold and a Karis average per box.
+void main() {
+    vec2 t = 1.0 / vec2(textureSize(screenTexture, 0));
+
+    vec3 a = texture(screenTexture, texCoord + t * vec2(-2.0, 2.0)).rgb;
+    vec3 b = texture(screenTexture, texCoord + t * vec2(0.0, 2.0)).rgb;
+    vec3 c = texture(screenTexture, texCoord + t * vec2(2.0, 2.0)).rgb;
+    vec3 d = texture(screenTexture, texCoord + t * vec2(-2.0, 0.0)).rgb;
+    vec3 e = texture(screenTexture, texCoord).rgb;
+    vec3 f = texture(screenTexture, texCoord + t * vec2(2.0, 0.0)).rgb;
+    vec3 g = texture(screenTexture, texCoord + t * vec2(-2.0, -2.0)).rgb;
+    vec3 h = texture(screenTexture, texCoord + t * vec2(0.0, -2.0)).rgb;
+    vec3 i = texture(screenTexture, texCoord + t * vec2(2.0, -2.0)).rgb;
+    vec3 j = texture(screenTexture, texCoord + t * vec2(-1.0, 1.0)).rgb;
+    vec3 k = texture(screenTexture, texCoord + t * vec2(1.0, 1.0)).rgb;
+    vec3 l = texture(screenTexture, texCoord + t * vec2(-1.0, -1.0)).rgb;
+    vec3 m = texture(screenTexture, texCoord + t * vec2(1.0, -1.0)).rgb;
+
+    vec3 color;
+    if (prefilter != 0) {
+        color = karisAverage(j, k, l, m) * 0.5
+              + karisAverage(a, b, d, e) * 0.125 + karisAverage(b, c, e, f) * 0.125
+              + karisAverage(d, e, g, h) * 0.125 + karisAverage(e, f, h, i) * 0.125;
+        color = applyThreshold(color);
+    } else {
+        color = (j + k + l + m) * 0.125
+              + (a + c + g + i) * 0.03125
+              + (b + d + f + h) * 0.0625
+              + e * 0.125;
+    }
+
+    FragColor = vec4(max(color, 0.0001), 1.0);
+}
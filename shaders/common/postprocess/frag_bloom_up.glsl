@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 texCoord;
+
+uniform sampler2D screenTexture;
+uniform float radius = 1.0;
+
+// 3x3 tent filter over the smaller level, blended additively onto the larger one
+void main() {
+    vec2 t = radius / vec2(textureSize(screenTexture, 0));
+
+    vec3 color = texture(screenTexture, texCoord).rgb * 4.0;
+    color += (texture(screenTexture, texCoord + vec2(t.x, 0.0)).rgb
+            + texture(screenTexture, texCoord - vec2(t.x, 0.0)).rgb
+            + texture(screenTexture, texCoord + vec2(0.0, t.y)).rgb
+            + texture(screenTexture, texCoord - vec2(0.0, t.y)).rgb) * 2.0;
+    color += texture(screenTexture, texCoord + t).rgb
+           + texture(screenTexture, texCoord - t).rgb
+           + texture(screenTexture, texCoord + vec2(t.x, -t.y)).rgb
+           + texture(screenTexture, texCoord + vec2(-t.x, t.y)).rgb;
+
+    FragColor = vec4(color / 16.0, 1.0);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 texCoord;
+
+uniform sampler2D screenTexture;
+uniform vec2 direction;
+
+// Separable Gaussian blur along direction, (1, 0) or (0, 1). The kernel is compiled in from
+// GaussianKernel::defines(), each tap past the centre is a bilinear fetch covering two texels.
+void main() {
+    vec2 texelStep = direction / vec2(textureSize(screenTexture, 0));
+    vec3 color = texture(screenTexture, texCoord).rgb * KERNEL_WEIGHTS[0];
+    for (int i = 1; i < KERNEL_TAPS; i++) {
+        vec2 offset = texelStep * KERNEL_OFFSETS[i];
+        color += texture(screenTexture, texCoord + offset).rgb * KERNEL_WEIGHTS[i];
+        color += texture(screenTexture, texCoord - offset).rgb * KERNEL_WEIGHTS[i];
+    }
+
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D luminanceTexture;
+uniform sampler2D previousTexture;
+uniform int topLevel;
+uniform float adaptation;
+uniform float exposureKey = 0.18;
+uniform float minExposure = 0.05;
+uniform float maxExposure = 8.0;
+
+// Rendered to a single texel: the adapted luminance eases towards this frame's average, adaptation being
+// 1 - exp(-dt * speed), and the exposure maps it to the key value. R is kept for the next frame, G is
+// what the auto exposure pointwise stage multiplies by.
+void main() {
+    float average = exp(texelFetch(luminanceTexture, ivec2(0), topLevel).r);
+    float previous = texelFetch(previousTexture, ivec2(0), 0).r;
+    float adapted = mix(previous, average, adaptation);
+    float exposure = clamp(exposureKey / max(adapted, 1e-4), minExposure, maxExposure);
+
+    FragColor = vec4(adapted, exposure, 0.0, 1.0);
+}
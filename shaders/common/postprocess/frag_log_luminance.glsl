@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 texCoord;
+
+uniform sampler2D screenTexture;
+uniform vec2 targetSize;
+
+float luma(vec3 color) {
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Log luminance of the scene at the reduction target's size, four bilinear taps per target texel. Its
+// mipmaps then average it down to one texel: the log of the geometric mean luminance.
+void main() {
+    vec2 quarter = 0.25 / targetSize;
+    float sum = 0.0;
+    for (int i = 0; i < 4; i++) {
+        vec2 offset = quarter * vec2(i % 2 == 0 ? -1.0 : 1.0, i < 2 ? -1.0 : 1.0);
+        sum += log(max(luma(texture(screenTexture, texCoord + offset).rgb), 1e-4));
+    }
+
+    FragColor = vec4(sum * 0.25, 0.0, 0.0, 1.0);
+}
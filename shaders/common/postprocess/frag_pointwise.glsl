@@ -0,0 +1,14 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 texCoord;
+
+uniform sampler2D screenTexture;
+
+// A run of pointwise stages fused into one pass. PostProcessing puts each stage's function in front of
+// this, renamed stage0, stage1... and defines APPLY_STAGES to call them in order.
+void main() {
+    vec3 color = texture(screenTexture, texCoord).rgb;
+    APPLY_STAGES(color)
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,33 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 texCoord;
+
+uniform sampler2D screenTexture;
+uniform float sharpness = 0.5;
+
+float luma(vec3 color) {
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Bilinear upscale, sharpened by how much contrast the source has around the pixel: flat areas and hard
+// edges are left alone, soft edges blurred by the upscale are sharpened most. The result is clamped to
+// the neighbourhood so edges don't ring. Works on HDR input, contrast is measured as a ratio.
+void main() {
+    vec2 texelSize = 1.0 / vec2(textureSize(screenTexture, 0));
+    vec3 center = texture(screenTexture, texCoord).rgb;
+    vec3 north = texture(screenTexture, texCoord + vec2(0.0, texelSize.y)).rgb;
+    vec3 south = texture(screenTexture, texCoord - vec2(0.0, texelSize.y)).rgb;
+    vec3 east = texture(screenTexture, texCoord + vec2(texelSize.x, 0.0)).rgb;
+    vec3 west = texture(screenTexture, texCoord - vec2(texelSize.x, 0.0)).rgb;
+
+    vec3 minColor = min(center, min(min(north, south), min(east, west)));
+    vec3 maxColor = max(center, max(max(north, south), max(east, west)));
+    float minLuma = luma(minColor), maxLuma = luma(maxColor);
+
+    float amount = sqrt(clamp(minLuma / max(maxLuma, 1e-4), 0.0, 1.0));
+    float weight = -amount * mix(0.125, 0.2, sharpness);
+
+    vec3 color = (center + (north + south + east + west) * weight) / (1.0 + 4.0 * weight);
+    FragColor = vec4(clamp(color, minColor, maxColor), 1.0);
+}
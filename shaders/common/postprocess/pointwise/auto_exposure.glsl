@@ -0,0 +1,6 @@
+// Exposure computed on the GPU by PostProcessAutoExposure, bound to its texture unit
+uniform sampler2D exposureTexture;
+
+vec3 STAGE(vec3 color, vec2 uv) {
+    return color * texelFetch(exposureTexture, ivec2(0), 0).g;
+}
@@ -0,0 +1,5 @@
+uniform float exposure = 1.0;
+
+vec3 STAGE(vec3 color, vec2 uv) {
+    return color * exposure;
+}
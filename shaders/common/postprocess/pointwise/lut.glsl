@@ -0,0 +1,10 @@
+// Tone curve and grading baked by ColorLut, bound to its texture unit. Same layout as color_lut.h: 32
+// texels per axis over log2(color / 0.18) from -10 to 8.
+uniform sampler3D lutTexture;
+
+vec3 STAGE(vec3 color, vec2 uv) {
+    vec3 ev = log2(max(color, vec3(1e-6)) / 0.18);
+    vec3 coord = clamp((ev + 10.0) / 18.0, 0.0, 1.0);
+    // Texel centres, the first and last texels hold the ends of the range
+    return texture(lutTexture, coord * (31.0 / 32.0) + 0.5 / 32.0).rgb;
+}
@@ -0,0 +1,23 @@
+// ACES fitted curve (Stephen Hill)
+vec3 STAGE(vec3 color, vec2 uv) {
+    // sRGB => XYZ => D65_2_D60 => AP1 => RRT_SAT
+    mat3 acesInput = mat3(
+        0.59719, 0.35458, 0.04823,
+        0.07600, 0.90834, 0.01566,
+        0.02840, 0.13383, 0.83777
+    );
+
+    // ODT_SAT => XYZ => D60_2_D65 => sRGB
+    mat3 acesOutput = mat3(
+        1.60475, -0.53108, -0.07367,
+        -0.10208, 1.10813, -0.00605,
+        -0.00327, -0.07276, 1.07602
+    );
+
+    color = color * acesInput;
+    vec3 a = color * (color + 0.0245786) - 0.000090537;
+    vec3 b = color * (0.983729 * color + 0.4329510) + 0.238081;
+    color = (a / b) * acesOutput;
+
+    return clamp(color, 0.0, 1.0);
+}
@@ -0,0 +1,3 @@
+vec3 STAGE(vec3 color, vec2 uv) {
+    return color / (color + vec3(1.0));
+}
@@ -0,0 +1,7 @@
+uniform float vignetteStrength = 0.25;
+
+// Darkens towards the corners, by up to vignetteStrength
+vec3 STAGE(vec3 color, vec2 uv) {
+    vec2 d = uv - 0.5;
+    return color * (1.0 - vignetteStrength * smoothstep(0.1, 0.5, dot(d, d)));
+}
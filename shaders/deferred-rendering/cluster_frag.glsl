@@ -0,0 +1,43 @@
+#version 330 core
+out vec4 FragColor;
+
+layout (std140) uniform Matrices {
+    mat4 view;
+    mat4 projection;
+};
+
+uniform usamplerBuffer clusterOffsets;
+uniform usamplerBuffer clusterLights;
+
+uniform vec3 clusterGrid;
+uniform vec2 screenSize;
+uniform float clusterNear;
+uniform float clusterLogRatio;
+
+int clusterIndex(vec3 fragPos) {
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int slice = int(log(max(depth, clusterNear) / clusterNear) / clusterLogRatio * clusterGrid.z);
+    ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / screenSize * clusterGrid.xy), slice);
+    cluster = clamp(cluster, ivec3(0), ivec3(clusterGrid) - 1);
+
+    return (cluster.z * int(clusterGrid.y) + cluster.y) * int(clusterGrid.x) + cluster.x;
+}
+
+void main() {
+    vec2 texCoord = gl_FragCoord.xy / screenSize;
+
+    vec3 fragPos, normal;
+    if (!readGBuffer(texCoord, fragPos, normal)) discard;
+
+    vec3 viewDir = normalize(fragPos - viewPos);
+    vec4 diffSpec = texture(gAlbedoSpec, texCoord);
+
+    uvec2 cluster = texelFetch(clusterOffsets, clusterIndex(fragPos)).xy;
+
+    vec3 color = vec3(0.0);
+    for (uint i = 0u; i < cluster.y; i++) {
+        int lightIndex = int(texelFetch(clusterLights, int(cluster.x + i)).x);
+        color += calculatePointLight(lightIndex, diffSpec.rgb, diffSpec.a, fragPos, normal, viewDir);
+    }
+    FragColor = vec4(color, 1.0);
+}
@@ -1,7 +1,15 @@
 #version 330 core
+
+// The compact layout has no position target, it is reconstructed from depth, and the normal is
+// octahedral-encoded into two channels
+#ifdef GBUFFER_COMPACT
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+#else
 layout (location = 0) out vec4 gPosition;
 layout (location = 1) out vec4 gNormal;
 layout (location = 2) out vec4 gAlbedoSpec;
+#endif
 
 in vec2 texCoord;
 in vec3 fragPos;
@@ -17,12 +25,27 @@ struct Material {
 
 uniform Material material;
 
-void main() {
-    gPosition = vec4(fragPos, 1.0);
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
 
+// Projects the normal onto an octahedron and unfolds the lower half over the corners, in [0, 1]
+vec2 octEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return e * 0.5 + 0.5;
+}
+
+void main() {
     vec3 normal = material.useNormalMap ? texture(material.normal0, texCoord).rgb : vec3(0.5, 0.5, 1.0);
-    normal = normal * 2.0 - 1.0;
-    gNormal = vec4(normalize(TBN * normal), 1.0);
+    normal = normalize(TBN * (normal * 2.0 - 1.0));
+
+#ifdef GBUFFER_COMPACT
+    gNormal = octEncode(normal);
+#else
+    gPosition = vec4(fragPos, 1.0);
+    gNormal = vec4(normal, 1.0);
+#endif
 
     gAlbedoSpec.rgb = texture(material.diffuse0, texCoord).rgb;
     gAlbedoSpec.a = texture(material.specular0, texCoord).r;
@@ -0,0 +1,191 @@
+// Shared by the light volume (d_frag) and clustered (cluster_frag) resolves: G-buffer decoding, the
+// point light buffer, shadow atlas sampling and the Phong point light. No #version line, the demo
+// inserts this right after the including shader's one, with the permutation defines in front of it.
+
+uniform vec3 viewPos;
+
+// G-buffer layouts: the wide one stores world position and normal in RGBA32F, the compact one
+// (GBUFFER_COMPACT) keeps depth, an octahedral normal in RG16 and reconstructs position from depth
+#ifdef GBUFFER_COMPACT
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+#else
+uniform sampler2D gPosition;
+#endif
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+
+struct PointLight {
+    vec3 position;
+    float radius;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    vec3 attenuation;
+};
+
+#define POINT_LIGHT_TEXELS 29
+
+uniform samplerBuffer pointLights;
+
+PointLight fetchPointLight(int idx) {
+    int base = idx * POINT_LIGHT_TEXELS;
+
+    PointLight light;
+    vec4 positionRadius = texelFetch(pointLights, base + 0);
+    light.position = positionRadius.xyz;
+    light.radius = positionRadius.w;
+    light.ambient = texelFetch(pointLights, base + 1).xyz;
+    light.diffuse = texelFetch(pointLights, base + 2).xyz;
+    light.specular = texelFetch(pointLights, base + 3).xyz;
+    light.attenuation = texelFetch(pointLights, base + 4).xyz;
+    return light;
+}
+
+// With SHADOW_HARDWARE_PCF the atlas is sampled with comparison enabled, over a Poisson disk
+#ifdef SHADOW_HARDWARE_PCF
+uniform sampler2DShadow shadowAtlas;
+#else
+uniform sampler2D shadowAtlas;
+#endif
+uniform samplerBuffer shadowRects;
+
+#define SHADOW_SLOT_FACES 6
+#define SAMPLES 20
+#define MAX_POISSON_TAPS 16
+
+uniform int poissonTaps;
+
+const vec2 poissonDisk[MAX_POISSON_TAPS] = vec2[](
+    vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+    vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+    vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+    vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+    vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+    vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+    vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+    vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+vec3 sampleOffsetDirections[SAMPLES] = vec3[](
+    vec3(1, 1, 1), vec3(1, -1, 1), vec3(-1, -1, 1), vec3(-1, 1, 1),
+    vec3(1, 1, -1), vec3(1, -1, -1), vec3(-1, -1, -1), vec3(-1, 1, -1),
+    vec3(1, 1, 0), vec3(1, -1, 0), vec3(-1, -1, 0), vec3(-1, 1, 0),
+    vec3(1, 0, 1), vec3(-1, 0, 1), vec3(1, 0, -1), vec3(-1, 0, -1),
+    vec3(0, 1, 1), vec3(0, -1, 1), vec3(0, -1, -1), vec3(0, 1, -1)
+);
+
+// Cube face of a direction and its [0, 1] coordinates, matching the face matrices of PointLight
+vec3 cubeFaceCoord(vec3 d) {
+    vec3 a = abs(d);
+    float face;
+    vec2 uv;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = d.x > 0.0 ? 0.0 : 1.0;
+        uv = vec2(d.x > 0.0 ? -d.z : d.z, -d.y) / a.x;
+    } else if (a.y >= a.z) {
+        face = d.y > 0.0 ? 2.0 : 3.0;
+        uv = vec2(d.x, d.y > 0.0 ? d.z : -d.z) / a.y;
+    } else {
+        face = d.z > 0.0 ? 4.0 : 5.0;
+        uv = vec2(d.z > 0.0 ? d.x : -d.x, -d.y) / a.z;
+    }
+    return vec3(uv * 0.5 + 0.5, face);
+}
+
+// 1 where the stored depth is at or beyond ref (a fraction of the light's radius), 0 where it's closer
+float sampleShadowAtlas(int slot, vec3 dir, float ref) {
+    vec3 faceCoord = cubeFaceCoord(dir);
+    vec4 rect = texelFetch(shadowRects, slot * SHADOW_SLOT_FACES + int(faceCoord.z));
+
+    // Keep filter taps inside the tile, neighbouring tiles belong to other faces or lights
+    vec2 halfTexel = 0.5 / vec2(textureSize(shadowAtlas, 0));
+    vec2 uv = clamp(rect.xy + faceCoord.xy * rect.zw, rect.xy + halfTexel, rect.xy + rect.zw - halfTexel);
+#ifdef SHADOW_HARDWARE_PCF
+    return texture(shadowAtlas, vec3(uv, ref));
+#else
+    return step(ref, texture(shadowAtlas, uv).r);
+#endif
+}
+
+float calculateShadow(int slot, PointLight light, vec3 fragPos) {
+    // Lights without an atlas tile this frame are unshadowed
+    if (texelFetch(shadowRects, slot * SHADOW_SLOT_FACES).z == 0.0) return 1.0;
+
+    vec3 fragToLight = fragPos - light.position;
+    float fragDepth = length(fragToLight);
+    float viewDistance = length(viewPos - fragPos);
+
+    float bias = 0.05;
+    float diskRadius = (1.0 + viewDistance / light.radius) / 25.0;
+    float ref = (fragDepth - bias) / light.radius;
+    float shadow = 0.0;
+
+#ifdef SHADOW_HARDWARE_PCF
+    vec3 n = fragToLight / fragDepth;
+    vec3 t = normalize(cross(n, abs(n.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+    vec3 b = cross(n, t);
+
+    for (int i = 0; i < poissonTaps; i++) {
+        vec2 offset = poissonDisk[i] * diskRadius * 1.5;
+        shadow += sampleShadowAtlas(slot, fragToLight + t * offset.x + b * offset.y, ref);
+    }
+    shadow /= float(poissonTaps);
+#else
+    for (int i = 0; i < SAMPLES; i++) {
+        shadow += sampleShadowAtlas(slot, fragToLight + sampleOffsetDirections[i] * diskRadius, ref);
+    }
+    shadow /= float(SAMPLES);
+#endif
+
+    return shadow;
+}
+
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 octDecode(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return normalize(n);
+}
+
+// False for pixels no geometry was drawn to
+bool readGBuffer(vec2 texCoord, out vec3 fragPos, out vec3 normal) {
+#ifdef GBUFFER_COMPACT
+    float depth = texture(gDepth, texCoord).r;
+    if (depth == 1.0) return false;
+
+    vec4 position = inverseViewProjection * vec4(vec3(texCoord, depth) * 2.0 - 1.0, 1.0);
+    fragPos = position.xyz / position.w;
+    normal = octDecode(texture(gNormal, texCoord).rg);
+#else
+    normal = texture(gNormal, texCoord).rgb;
+    if (length(normal) == 0.0) return false;
+
+    fragPos = texture(gPosition, texCoord).xyz;
+#endif
+    return true;
+}
+
+vec3 calculatePointLight(int idx, vec3 diffMap, float specMap, vec3 fragPos, vec3 normal, vec3 viewDir) {
+    PointLight light = fetchPointLight(idx);
+    vec3 ambient = diffMap * light.ambient;
+
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(lightDir, normal), 0.0);
+    vec3 diffuse = diff * diffMap * light.diffuse;
+
+    vec3 reflectionDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectionDir), 0.0), 32.0);
+    vec3 specular = specMap * spec * light.specular;
+
+    float dist = length(light.position - fragPos);
+    float attenuation = light.attenuation.x + light.attenuation.y * dist + light.attenuation.z * dist * dist;
+
+    float shadow = calculateShadow(idx, light, fragPos);
+
+    return (ambient + (diffuse + specular) * shadow) / attenuation;
+}
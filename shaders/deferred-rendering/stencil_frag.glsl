@@ -0,0 +1,5 @@
+#version 330 core
+
+// Light volume stencil pass, only the stencil buffer is written
+void main() {
+}
@@ -17,26 +17,57 @@ struct Material {
 
 struct PointLight {
     vec3 position;
+    float radius;
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
     vec3 attenuation;
-    mat4 lightMatrices[6];
 };
 
+#ifndef MAX_LIGHTS
+#define MAX_LIGHTS 1
+#endif
+#define POINT_LIGHT_TEXELS 29
+
 uniform Material material;
-layout (std140) uniform PointLightBlock0 {
-    PointLight pointLight0;
-};
-layout (std140) uniform PointLightBlock1 {
-    PointLight pointLight1;
-};
-uniform samplerCube shadowMap0;
-uniform samplerCube shadowMap1;
-uniform float farPlane;
+uniform samplerBuffer pointLights;
+uniform int lightCount;
+uniform int lightIndices[MAX_LIGHTS];
+
+// Shadow filtering modes, SHADOW_FILTER is defined by the program when compiling each mode
+#define FILTER_MANUAL 0
+#define FILTER_HARDWARE_PCF 1
+#define FILTER_VARIANCE 2
+#define FILTER_EXPONENTIAL 3
+#ifndef SHADOW_FILTER
+#define SHADOW_FILTER FILTER_MANUAL
+#endif
+
+// Hardware PCF compares against the depth cubemap, the prefiltered modes sample a moments cubemap
+#if SHADOW_FILTER == FILTER_HARDWARE_PCF
+#define ShadowSampler samplerCubeShadow
+#else
+#define ShadowSampler samplerCube
+#endif
+uniform ShadowSampler shadowMaps[MAX_LIGHTS];
 
 #define SAMPLES 20
 #define THRESHOLD 1.0
+#define MAX_POISSON_TAPS 16
+
+uniform int poissonTaps;
+uniform float esmExponent;
+
+const vec2 poissonDisk[MAX_POISSON_TAPS] = vec2[](
+    vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+    vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+    vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+    vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+    vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+    vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+    vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+    vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
 
 vec3 sampleOffsetDirections[SAMPLES] = vec3[](
     vec3(1, 1, 1), vec3(1, -1, 1), vec3(-1, -1, 1), vec3(-1, 1, 1),
@@ -46,25 +77,68 @@ vec3 sampleOffsetDirections[SAMPLES] = vec3[](
     vec3(0, 1, 1), vec3(0, -1, 1), vec3(0, -1, -1), vec3(0, 1, -1)
 );
 
-float calculateShadow(PointLight light, samplerCube shadowMap) {
+PointLight fetchPointLight(int idx) {
+    int base = idx * POINT_LIGHT_TEXELS;
+
+    PointLight light;
+    vec4 positionRadius = texelFetch(pointLights, base + 0);
+    light.position = positionRadius.xyz;
+    light.radius = positionRadius.w;
+    light.ambient = texelFetch(pointLights, base + 1).xyz;
+    light.diffuse = texelFetch(pointLights, base + 2).xyz;
+    light.specular = texelFetch(pointLights, base + 3).xyz;
+    light.attenuation = texelFetch(pointLights, base + 4).xyz;
+    return light;
+}
+
+float calculateShadow(PointLight light, ShadowSampler shadowMap) {
     vec3 fragToLight = fragPos - light.position;
     float fragDepth = length(fragToLight);
     float viewDistance = length(viewPos - fragPos);
 
     float bias = 0.05;
-    float diskRadius = (1.0 + viewDistance / farPlane) / 25.0;
+    float diskRadius = (1.0 + viewDistance / light.radius) / 25.0;
     float shadow = 0.0;
 
+#if SHADOW_FILTER == FILTER_MANUAL
     for (int i = 0; i < SAMPLES; i++) {
         float closestDepth = texture(shadowMap, fragToLight + sampleOffsetDirections[i] * diskRadius).x;
-        closestDepth *= farPlane;
+        closestDepth *= light.radius;
         shadow += step(fragDepth - bias, closestDepth);
     }
     shadow /= float(SAMPLES);
+#elif SHADOW_FILTER == FILTER_HARDWARE_PCF
+    // Each tap is a bilinear 2x2 comparison, spread over a Poisson disk facing the light
+    vec3 n = fragToLight / fragDepth;
+    vec3 t = normalize(cross(n, abs(n.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+    vec3 b = cross(n, t);
+    float ref = (fragDepth - bias) / light.radius;
+
+    for (int i = 0; i < poissonTaps; i++) {
+        vec2 offset = poissonDisk[i] * diskRadius * 1.5;
+        shadow += texture(shadowMap, vec4(fragToLight + t * offset.x + b * offset.y, ref));
+    }
+    shadow /= float(poissonTaps);
+#elif SHADOW_FILTER == FILTER_VARIANCE
+    // Chebyshev upper bound on the fraction of occluders, the low end is cut off to reduce light bleeding
+    vec2 moments = texture(shadowMap, fragToLight).xy;
+    float depth = fragDepth / light.radius;
+    if (depth <= moments.x) return 1.0;
+
+    float variance = max(moments.y - moments.x * moments.x, 0.00002);
+    float d = depth - moments.x;
+    shadow = clamp((variance / (variance + d * d) - 0.2) / 0.8, 0.0, 1.0);
+#else
+    // exp(c * occluder) * exp(-c * receiver) is ~1 when lit and falls off quickly behind an occluder
+    float occluder = texture(shadowMap, fragToLight).x;
+    float depth = (fragDepth - bias) / light.radius;
+    shadow = clamp(occluder * exp(-esmExponent * depth), 0.0, 1.0);
+#endif
 
     return shadow;
 }
-vec3 calculatePointLight(PointLight light, vec3 diffMap, vec3 specMap, vec3 viewDir, samplerCube shadowMap) {
+
+vec3 calculatePointLight(PointLight light, vec3 diffMap, vec3 specMap, vec3 viewDir, ShadowSampler shadowMap) {
     vec3 ambient = diffMap * light.ambient;
 
     vec3 normal = material.useNormalMap ? texture(material.normal0, texCoord).rgb : vec3(0.5, 0.5, 1.0);
@@ -87,13 +161,28 @@ vec3 calculatePointLight(PointLight light, vec3 diffMap, vec3 specMap, vec3 view
     return (ambient + (diffuse + specular) * shadow) / attenuation;
 }
 
+// Sampler arrays can only be indexed with constant expressions, so the light loop is unrolled
+#define SHADE_LIGHT(i) if (i < lightCount) color += calculatePointLight(fetchPointLight(lightIndices[i]), diffMap, specMap, viewDir, shadowMaps[i]);
+
 void main() {
     vec3 diffMap = vec3(texture(material.diffuse0, texCoord));
     vec3 specMap = vec3(texture(material.specular0, texCoord));
     vec3 viewDir = normalize(fragPos - viewPos);
 
     vec3 color = vec3(0.0);
-    color += calculatePointLight(pointLight0, diffMap, specMap, viewDir, shadowMap0);
-    color += calculatePointLight(pointLight1, diffMap, specMap, viewDir, shadowMap1);
+    SHADE_LIGHT(0)
+#if MAX_LIGHTS > 1
+    SHADE_LIGHT(1)
+#endif
+#if MAX_LIGHTS > 2
+    SHADE_LIGHT(2)
+    SHADE_LIGHT(3)
+#endif
+#if MAX_LIGHTS > 4
+    SHADE_LIGHT(4)
+    SHADE_LIGHT(5)
+    SHADE_LIGHT(6)
+    SHADE_LIGHT(7)
+#endif
     FragColor = vec4(color, 1.0);
 }
\ No newline at end of file
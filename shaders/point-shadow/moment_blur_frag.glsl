@@ -0,0 +1,35 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 texCoord;
+
+uniform samplerCube moments;
+uniform int face;
+uniform vec2 direction;
+
+// Direction through a point of the face, uv in [-1, 1], matching GL's cubemap face orientation
+vec3 faceDirection(vec2 uv) {
+    if (face == 0) return vec3(1.0, -uv.y, -uv.x);
+    if (face == 1) return vec3(-1.0, -uv.y, uv.x);
+    if (face == 2) return vec3(uv.x, 1.0, uv.y);
+    if (face == 3) return vec3(uv.x, -1.0, -uv.y);
+    if (face == 4) return vec3(uv.x, -uv.y, 1.0);
+    return vec3(-uv.x, -uv.y, -1.0);
+}
+
+// Separable Gaussian over one face of a moments cubemap, the kernel comes from GaussianKernel::defines()
+// as in frag_blur.glsl. Taps past the edge of the face continue on its neighbour (seamless filtering is
+// on), so blurred faces still meet.
+void main() {
+    vec2 texelStep = 2.0 * direction / vec2(textureSize(moments, 0));
+    vec2 uv = texCoord * 2.0 - 1.0;
+
+    vec2 sum = texture(moments, faceDirection(uv)).rg * KERNEL_WEIGHTS[0];
+    for (int i = 1; i < KERNEL_TAPS; i++) {
+        vec2 offset = texelStep * KERNEL_OFFSETS[i];
+        sum += texture(moments, faceDirection(uv + offset)).rg * KERNEL_WEIGHTS[i];
+        sum += texture(moments, faceDirection(uv - offset)).rg * KERNEL_WEIGHTS[i];
+    }
+
+    FragColor = vec4(sum, 0.0, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 lightMatrix;
+
+out vec4 fragPos;
+
+void main() {
+    fragPos = model * vec4(aPos, 1.0);
+    gl_Position = lightMatrix * fragPos;
+}
@@ -1,22 +1,24 @@
 #version 330 core
 
-struct PointLight {
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    vec3 attenuation;
-    mat4 lightMatrices[6];
-};
+#define POINT_LIGHT_TEXELS 29
 
-layout (std140) uniform PointLightBlock {
-    PointLight pointLight;
-};
-uniform float farPlane;
+uniform samplerBuffer pointLights;
+uniform int lightIndex;
+
+// Only written when a moments cubemap is attached: (d, d^2) for variance shadows, or exp(c * d) when
+// esmExponent is set, for exponential shadows. Alpha is written too, the target is RG32F but leaving it
+// undefined would make any enabled blending undefined as well
+uniform float esmExponent;
+out vec4 moments;
 
 in vec4 fragPos;
 
 void main() {
-    float lightDistance = length(fragPos.xyz - pointLight.position);
-    gl_FragDepth = lightDistance / farPlane;
+    // Depth is stored as a fraction of the light's radius, which is also its shadow far plane
+    vec4 light = texelFetch(pointLights, lightIndex * POINT_LIGHT_TEXELS);
+    float lightDistance = length(fragPos.xyz - light.xyz);
+    float depth = lightDistance / light.w;
+    gl_FragDepth = depth;
+    vec2 m = esmExponent > 0.0 ? vec2(exp(esmExponent * depth), 0.0) : vec2(depth, depth * depth);
+    moments = vec4(m, 0.0, 1.0);
 }
@@ -2,29 +2,33 @@
 layout (triangles) in;
 layout (triangle_strip, max_vertices = 18) out;
 
-struct PointLight {
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    vec3 attenuation;
-    mat4 lightMatrices[6];
-};
+#define POINT_LIGHT_TEXELS 29
+#define LIGHT_MATRICES_OFFSET 5
 
-layout (std140) uniform PointLightBlock {
-    PointLight pointLight;
-};
+uniform samplerBuffer pointLights;
+uniform int lightIndex;
 
 out vec4 fragPos;
 
+mat4 fetchLightMatrix(int face) {
+    int base = lightIndex * POINT_LIGHT_TEXELS + LIGHT_MATRICES_OFFSET + face * 4;
+    return mat4(
+        texelFetch(pointLights, base + 0),
+        texelFetch(pointLights, base + 1),
+        texelFetch(pointLights, base + 2),
+        texelFetch(pointLights, base + 3)
+    );
+}
+
 void main() {
     for (int face = 0; face < 6; face++) {
+        mat4 lightMatrix = fetchLightMatrix(face);
         gl_Layer = face;
         for (int i = 0; i < 3; i++) {
             fragPos = gl_in[i].gl_Position;
-            gl_Position = pointLight.lightMatrices[face] * fragPos;
+            gl_Position = lightMatrix * fragPos;
             EmitVertex();
         }
         EndPrimitive();
     }
-}
\ No newline at end of file
+}
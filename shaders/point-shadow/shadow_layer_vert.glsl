@@ -0,0 +1,32 @@
+#version 330 core
+#extension GL_ARB_shader_viewport_layer_array : require
+layout (location = 0) in vec3 aPos;
+
+#define POINT_LIGHT_TEXELS 29
+#define LIGHT_MATRICES_OFFSET 5
+
+uniform samplerBuffer pointLights;
+uniform int lightIndex;
+uniform mat4 model;
+
+// Cube faces the caster shows up in, one instance per face
+uniform int faces[6];
+
+out vec4 fragPos;
+
+mat4 fetchLightMatrix(int face) {
+    int base = lightIndex * POINT_LIGHT_TEXELS + LIGHT_MATRICES_OFFSET + face * 4;
+    return mat4(
+        texelFetch(pointLights, base + 0),
+        texelFetch(pointLights, base + 1),
+        texelFetch(pointLights, base + 2),
+        texelFetch(pointLights, base + 3)
+    );
+}
+
+void main() {
+    int face = faces[gl_InstanceID];
+    fragPos = model * vec4(aPos, 1.0);
+    gl_Layer = face;
+    gl_Position = fetchLightMatrix(face) * fragPos;
+}
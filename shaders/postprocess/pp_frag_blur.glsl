@@ -7,31 +7,25 @@ uniform sampler2D screenTexture;
 uniform int screenWidth;
 uniform int screenHeight;
 
-void main() {
-    float xOffset = 1.0 / screenWidth;
-    float yOffset = 1.0 / screenHeight;
-
-    vec2 offsets[9] = vec2[](
-        vec2(-xOffset, yOffset),
-        vec2(0.0, yOffset),
-        vec2(xOffset, yOffset),
-        vec2(-xOffset, 0.0),
-        vec2(0.0, 0.0),
-        vec2(xOffset, 0.0),
-        vec2(-xOffset, -yOffset),
-        vec2(0.0, -yOffset),
-        vec2(xOffset, -yOffset)
-    );
+// The kernel normally comes from GaussianKernel::defines(), this is the 3x3 binomial blur
+#ifndef KERNEL_TAPS
+#define KERNEL_TAPS 2
+const float KERNEL_OFFSETS[KERNEL_TAPS] = float[](0.0, 1.0);
+const float KERNEL_WEIGHTS[KERNEL_TAPS] = float[](0.5, 0.25);
+#endif
 
-    float kernel[9] = float[](
-        1.0 / 16, 2.0 / 16, 1.0 / 16,
-        2.0 / 16, 4.0 / 16, 2.0 / 16,
-        1.0 / 16, 2.0 / 16, 1.0 / 16
-    );
+// Single pass 2D Gaussian: the kernel is separable, so every pair of 1D taps is one bilinear fetch
+// weighted by the product of their weights
+void main() {
+    vec2 texelSize = vec2(1.0 / screenWidth, 1.0 / screenHeight);
 
     vec3 color = vec3(0.0);
-    for (int i = 0; i < 9; i++) {
-        color += kernel[i] * vec3(texture(screenTexture, texCoord + offsets[i]));
+    for (int x = 1 - KERNEL_TAPS; x < KERNEL_TAPS; x++) {
+        for (int y = 1 - KERNEL_TAPS; y < KERNEL_TAPS; y++) {
+            vec2 offset = vec2(sign(float(x)) * KERNEL_OFFSETS[abs(x)], sign(float(y)) * KERNEL_OFFSETS[abs(y)]);
+            float weight = KERNEL_WEIGHTS[abs(x)] * KERNEL_WEIGHTS[abs(y)];
+            color += weight * vec3(texture(screenTexture, texCoord + offset * texelSize));
+        }
     }
 
     FragColor = vec4(color, 1.0);
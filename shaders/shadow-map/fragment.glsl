@@ -4,7 +4,7 @@ out vec4 FragColor;
 in vec2 texCoord;
 in vec3 normal;
 in vec3 fragPos;
-in vec4 fragPosLightSpace;
+in float viewDepth;
 
 uniform vec3 viewPos;
 
@@ -14,12 +14,17 @@ struct Material {
     float shininess;
 };
 
+#define MAX_CASCADES 4
+
 struct DirectionalLight {
     vec3 direction;
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
     mat4 lightMatrix;
+    mat4 cascadeMatrices[MAX_CASCADES];
+    vec4 cascadeSplits;
+    int cascadeCount;
 };
 
 uniform Material material;
@@ -27,19 +32,27 @@ layout (std140) uniform DirectionalLightBlock {
     DirectionalLight directionalLight;
 };
 uniform samplerCube skybox;
-uniform sampler2D shadowMap;
+uniform sampler2DArray shadowMap;
 
 float calculateShadow(DirectionalLight light) {
+    // Nearest cascade whose slice contains the fragment, past the last one there is no shadow
+    int cascade = 0;
+    while (cascade < light.cascadeCount && viewDepth > light.cascadeSplits[cascade]) cascade++;
+    if (cascade == light.cascadeCount) return 1.0;
+
+    vec4 fragPosLightSpace = light.cascadeMatrices[cascade] * vec4(fragPos, 1.0);
     vec3 lightSpace = fragPosLightSpace.xyz / fragPosLightSpace.w;
     lightSpace = lightSpace * 0.5 + 0.5;
-    float bias = max(0.05 * (1.0 - dot(normal, -light.direction)), 0.005);
     float fragDepth = lightSpace.z;
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+
+    // Each cascade spans as much depth as it does width, so a bias in texels works for all of them
+    float bias = max(3.0 * (1.0 - dot(normal, -light.direction)), 1.0) * 2.0 * texelSize.x;
 
     for (int x = -1; x <= 1; x++) {
         for (int y = -1; y <= 1; y++) {
-            float closestDepth = texture(shadowMap, lightSpace.xy + vec2(x, y) * texelSize).r;
+            float closestDepth = texture(shadowMap, vec3(lightSpace.xy + vec2(x, y) * texelSize, cascade)).r;
             shadow += step(fragDepth - bias, closestDepth);
         }
     }
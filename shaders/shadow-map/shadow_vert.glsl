@@ -2,12 +2,18 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
+uniform int cascade;
+#define MAX_CASCADES 4
+
 struct DirectionalLight {
     vec3 direction;
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
     mat4 lightMatrix;
+    mat4 cascadeMatrices[MAX_CASCADES];
+    vec4 cascadeSplits;
+    int cascadeCount;
 };
 
 layout (std140) uniform DirectionalLightBlock {
@@ -15,5 +21,5 @@ layout (std140) uniform DirectionalLightBlock {
 };
 
 void main() {
-    gl_Position = directionalLight.lightMatrix * model * vec4(aPos, 1.0);
+    gl_Position = directionalLight.cascadeMatrices[cascade] * model * vec4(aPos, 1.0);
 }
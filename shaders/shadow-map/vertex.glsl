@@ -6,7 +6,7 @@ layout (location = 2) in vec2 aTexCoord;
 out vec2 texCoord;
 out vec3 normal;
 out vec3 fragPos;
-out vec4 fragPosLightSpace;
+out float viewDepth;
 
 uniform mat4 model;
 layout (std140) uniform Matrices {
@@ -14,12 +14,17 @@ layout (std140) uniform Matrices {
     mat4 projection;
 };
 
+#define MAX_CASCADES 4
+
 struct DirectionalLight {
     vec3 direction;
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
     mat4 lightMatrix;
+    mat4 cascadeMatrices[MAX_CASCADES];
+    vec4 cascadeSplits;
+    int cascadeCount;
 };
 
 layout (std140) uniform DirectionalLightBlock {
@@ -32,7 +37,7 @@ void main() {
     normal = normalize(normalModel * aNormal);
     vec4 modelPos = model * vec4(aPos, 1.0);
     fragPos = vec3(modelPos);
-    fragPosLightSpace = directionalLight.lightMatrix * modelPos;
+    viewDepth = -(view * modelPos).z;
 
     gl_Position = projection * view * modelPos;
 }
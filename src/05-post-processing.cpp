@@ -9,6 +9,7 @@
 #include <window.h>
 #include <light.h>
 #include <framebuffer.h>
+#include <gaussian_kernel.h>
 
 #define WIDTH 800
 #define HEIGHT 600
@@ -87,7 +88,9 @@ int main() {
   Shader pp_frag_gray = Shader::fragment("shaders/post-processing/pp_frag_gray.glsl");
   Program program_gray(pp_vertex, pp_frag_gray);
   post_programs.push_back(&program_gray);
-  Shader pp_frag_blur = Shader::fragment("shaders/post-processing/pp_frag_blur.glsl");
+  Shader pp_frag_blur = Shader::fragment(
+    "shaders/post-processing/pp_frag_blur.glsl", GaussianKernel::from_radius(2).defines()
+  );
   Program program_blur(pp_vertex, pp_frag_blur);
   post_programs.push_back(&program_blur);
   Shader pp_frag_sharpen = Shader::fragment("shaders/post-processing/pp_frag_sharpen.glsl");
@@ -12,6 +12,8 @@
 #define WIDTH 800
 #define HEIGHT 600
 
+#define CASCADES 3
+
 using namespace glm;
 
 Camera *camera_ptr;
@@ -123,7 +125,8 @@ int main() {
 
   // Setup shadow framebuffer
   // --------------------------------------------
-  DepthFramebuffer shadow_depth_buffer(SHADOW_WIDTH, SHADOW_HEIGHT);
+  DepthArrayFramebuffer shadow_depth_buffer(SHADOW_WIDTH, SHADOW_HEIGHT, CASCADES);
+  std::vector<const Instance *> casters = {&floor, &box1, &box2};
 
   // Rendering loop
   // --------------------------------------------
@@ -138,17 +141,26 @@ int main() {
     glfwGetFramebufferSize(window, &width, &height);
 
     // Update light
+    float aspect = height > 0 ? (float) width / (float) height : 1.0f;
     light.direction = vec3(cos(current_frame) * 0.5f, -1.0f, sin(current_frame) * 0.5f);
+    light.fit_cascades(camera, aspect, CASCADES, SHADOW_WIDTH);
     program.use();
     light.update_ubo();
 
-    // Shadow mapping
+    // Shadow mapping, one layer per cascade with only the casters it sees. Depth clamping keeps casters
+    // between the light and the cascade's near plane.
     glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    shadow_depth_buffer.bind();
-    glClear(GL_DEPTH_BUFFER_BIT);
-    floor.draw_with(shadow_program);
-    box1.draw_with(shadow_program);
-    box2.draw_with(shadow_program);
+    glEnable(GL_DEPTH_CLAMP);
+    shadow_program.use();
+    for (unsigned c = 0; c < light.cascades(); c++) {
+      shadow_depth_buffer.bind_layer((int) c);
+      glClear(GL_DEPTH_BUFFER_BIT);
+      shadow_program.set("cascade", (int) c);
+      for (const auto *caster: casters) {
+        if (light.cascade_sees(c, caster->bounds())) caster->draw_with(shadow_program);
+      }
+    }
+    glDisable(GL_DEPTH_CLAMP);
     Framebuffer::unbind();
 
     // Rendering code
@@ -156,13 +168,13 @@ int main() {
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    camera.update_matrices((float) width / (float) height);
+    camera.update_matrices(aspect);
 
     program.use();
     program.set("viewPos", camera.position);
     skybox_texture.bind(10);
     glActiveTexture(GL_TEXTURE0 + 11);
-    glBindTexture(GL_TEXTURE_2D, shadow_depth_buffer.depth_map());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadow_depth_buffer.depth_map());
 
     floor.draw();
     box1.draw();
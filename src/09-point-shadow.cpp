@@ -7,49 +7,318 @@
 #include <instance.h>
 #include <window.h>
 #include <light.h>
+#include <light_buffer.h>
+#include <light_lists.h>
 #include <postprocess.h>
 #include <postprocess/bloom.h>
+#include <gaussian_kernel.h>
+#include <gpu_timer.h>
+
+#include <cstring>
 
 #define WIDTH 800
 #define HEIGHT 600
 
+#define SHADOW_MAP_UNIT 4
+#define LIGHT_BUFFER_UNIT 12
+
+#define SHADOW_FILTERS 4
+#define MOMENT_MAP_SIZE 512
+#define MOMENT_BLUR_RADIUS 4
+#define ESM_EXPONENT 80.0f
+#define BENCHMARK_FRAMES 240
+
 using namespace glm;
 
+namespace {
+bool has_extension(const char *name) {
+  int count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (int i = 0; i < count; i++) {
+    if (std::strcmp((const char *) glGetStringi(GL_EXTENSIONS, i), name) == 0) return true;
+  }
+  return false;
+}
+
+unsigned create_cubemap(int size, GLint internal_format, GLenum format, GLint filter) {
+  unsigned cubemap;
+  glGenTextures(1, &cubemap);
+
+  glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+  for (unsigned f = GL_TEXTURE_CUBE_MAP_POSITIVE_X; f <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z; f++) {
+    glTexImage2D(f, 0, internal_format, size, size, 0, format, GL_FLOAT, nullptr);
+  }
+
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, filter);
+  return cubemap;
+}
+}
+
 class PointShadowWindow : public Window {
 public:
-  PointShadowWindow() : Window(WIDTH, HEIGHT, "Learn OpenGL 09 — Point shadows") {
+  explicit PointShadowWindow(unsigned light_count = 2)
+    : Window(WIDTH, HEIGHT, "Learn OpenGL 09 — Point shadows"), light_count(max(light_count, 1u)) {
   }
 
 private:
-  Program program, light_program, shadow_program;
-  std::vector<Program> post_programs;
+  // Shadow filtering, cycled with F: 20 manual depth taps, hardware PCF over a Poisson disk (K cycles the
+  // tap count), or a single filtered tap of a blurred variance or exponential moments cubemap
+  enum class ShadowFilter {
+    Manual, HardwarePcf, Variance, Exponential
+  };
+  ShadowFilter shadow_filter = ShadowFilter::Manual;
+  int poisson_taps = 8;
+
+  Program light_program, shadow_program, layer_shadow_program, face_shadow_program, moment_blur_program;
+  std::unique_ptr<LightListPrograms> programs[SHADOW_FILTERS];
+  std::vector<std::string> tonemappers = {
+    "shaders/common/postprocess/pointwise/tm_none.glsl",
+    "shaders/common/postprocess/pointwise/tm_reinhard.glsl",
+    "shaders/common/postprocess/pointwise/tm_aces.glsl"
+  };
 
   std::unique_ptr<Model> room_model, box_model, light_model;
   std::unique_ptr<Instance> room;
   std::vector<Instance> boxes;
   std::vector<Instance> light_objs;
 
-  std::vector<PointLight> lights;
+  unsigned light_count;
+  std::unique_ptr<PointLightBuffer> lights;
+  std::vector<vec4> light_spheres;
   std::vector<unsigned> depth_cubemaps;
   std::vector<unsigned> shadow_depth_fbos;
 
+  // Prefiltered modes render moments at a lower resolution, all lights share the depth buffer. Each
+  // updated cubemap is then blurred through the scratch cubemap and back.
+  std::vector<unsigned> moment_cubemaps;
+  unsigned moment_depth_cubemap = 0, moment_blur_cubemap = 0, moment_blur_fbo = 0;
+  std::unique_ptr<Mesh> screen_quad;
+
+  // Each cubemap is redrawn only when its light moves, all casters in this scene are static
+  std::vector<vec4> cached_spheres;
+  std::vector<bool> shadow_valid;
+  unsigned rendered_maps = 0, frames_since_report = 0;
+
+  bool paused = false;
+  float light_time = 0.0f;
+
+  // The geometry shader path sends every triangle to all six faces. The other two cull casters per face
+  // on the CPU, and either draw one instance per visible face with gl_Layer set in the vertex shader
+  // (needs ARB_shader_viewport_layer_array) or draw each face in its own pass.
+  enum class ShadowPath {
+    GeometryShader, Layered, PerFace
+  };
+  ShadowPath shadow_path = ShadowPath::GeometryShader;
+  bool layered_supported = false;
+  std::vector<unsigned> caster_faces;
+
+  std::unique_ptr<GpuTimer> shadow_timer, lighting_timer;
+  std::unique_ptr<GpuCounter> shadow_primitives;
+
+  // Lighting pass benchmark, started with T: every filter runs for BENCHMARK_FRAMES frames
+  bool benchmarking = false;
+  unsigned benchmark_frames = 0;
+  double benchmark_ms[SHADOW_FILTERS] = {};
+
   std::unique_ptr<PostProcessing> post_processing;
 
-  unsigned pp_frag_idx = 0;
+  unsigned tonemapper_idx = 2;
 
-  void setup() override {
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  LightListPrograms &lit_programs() const {
+    return *programs[(int) shadow_filter];
+  }
+
+  bool prefiltered() const {
+    return shadow_filter == ShadowFilter::Variance || shadow_filter == ShadowFilter::Exponential;
+  }
+
+  int shadow_size() const {
+    return prefiltered() ? MOMENT_MAP_SIZE : SHADOW_WIDTH;
+  }
+
+  // Draws an instance with the smallest shader permutation that fits its light list
+  void draw_lit(const Instance &obj) const {
+    const Program &program = lit_programs().select(obj.lights.size());
+    int count = (int) obj.lights.size();
+
+    int light_indices[MAX_OBJECT_LIGHTS];
+    for (int i = 0; i < count; i++) {
+      light_indices[i] = (int) obj.lights[i];
+      unsigned shadow_map = prefiltered() ? moment_cubemaps[obj.lights[i]] : depth_cubemaps[obj.lights[i]];
+      glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_UNIT + i);
+      glBindTexture(GL_TEXTURE_CUBE_MAP, shadow_map);
+    }
+
+    program.use();
+    program.set("lightCount", count);
+    program.set("lightIndices", light_indices, count);
+    obj.draw_with(program);
+  }
+
+  // Attaches a single cube face, or the whole cubemap (face < 0) for layered rendering
+  void attach_shadow_targets(unsigned light, int face = -1) const {
+    unsigned depth = prefiltered() ? moment_depth_cubemap : depth_cubemaps[light];
+    unsigned color = prefiltered() ? moment_cubemaps[light] : 0;
+
+    if (face < 0) {
+      glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth, 0);
+      glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color, 0);
+    } else {
+      GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, depth, 0);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target, color, 0);
+    }
+    glDrawBuffer(color ? GL_COLOR_ATTACHMENT0 : GL_NONE);
+  }
+
+  void clear_shadow_targets() const {
+    if (!prefiltered()) {
+      glClear(GL_DEPTH_BUFFER_BIT);
+      return;
+    }
+
+    // Texels nothing was drawn to read as an occluder at the far plane, fully lit
+    float far = shadow_filter == ShadowFilter::Exponential ? exp(ESM_EXPONENT) : 1.0f;
+    glClearColor(far, 1.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  }
+
+  void render_shadow_map(unsigned light) {
+    glBindFramebuffer(GL_FRAMEBUFFER, shadow_depth_fbos[light]);
+    attach_shadow_targets(light);
+
+    if (shadow_path == ShadowPath::GeometryShader) {
+      clear_shadow_targets();
+      shadow_program.use();
+      shadow_program.set("lightIndex", (int) light);
+      for (const auto &box: boxes) box.draw_with(shadow_program);
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      return;
+    }
+
+    vec3 position = vec3(light_spheres[light]);
+    float radius = light_spheres[light].w;
+    caster_faces.resize(boxes.size());
+    for (unsigned i = 0; i < boxes.size(); i++) caster_faces[i] = boxes[i].bounds().cube_faces(position, radius);
+
+    if (shadow_path == ShadowPath::Layered) {
+      clear_shadow_targets();
+      layer_shadow_program.use();
+      layer_shadow_program.set("lightIndex", (int) light);
+
+      for (unsigned i = 0; i < boxes.size(); i++) {
+        int faces[6], count = 0;
+        for (int face = 0; face < 6; face++) {
+          if (caster_faces[i] & (1u << face)) faces[count++] = face;
+        }
+        if (count == 0) continue;
+
+        layer_shadow_program.set("faces", faces, count);
+        boxes[i].draw_instanced_with(layer_shadow_program, count);
+      }
+    } else {
+      // Attach one face at a time, the whole cubemap is attached again on the next update
+      const mat4 *matrices = (*lights)[light].shadow_matrices();
+      face_shadow_program.use();
+      face_shadow_program.set("lightIndex", (int) light);
+
+      for (unsigned face = 0; face < 6; face++) {
+        attach_shadow_targets(light, (int) face);
+        clear_shadow_targets();
+
+        mat4 light_matrix = matrices[face];
+        face_shadow_program.set_matrix("lightMatrix", light_matrix);
+        for (unsigned i = 0; i < boxes.size(); i++) {
+          if (caster_faces[i] & (1u << face)) boxes[i].draw_with(face_shadow_program);
+        }
+      }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  // Separable Gaussian over every face. Without it the only filtering of the moments is the 2x2 bilinear
+  // tap, which leaves hard, light-bleeding edges instead of soft penumbrae.
+  void blur_moments(unsigned light) const {
+    glBindFramebuffer(GL_FRAMEBUFFER, moment_blur_fbo);
+    moment_blur_program.use();
+
+    unsigned sources[2] = {moment_cubemaps[light], moment_blur_cubemap};
+    unsigned targets[2] = {moment_blur_cubemap, moment_cubemaps[light]};
+    for (int pass = 0; pass < 2; pass++) {
+      moment_blur_program.set("direction", pass == 0 ? vec2(1.0f, 0.0f) : vec2(0.0f, 1.0f));
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_CUBE_MAP, sources[pass]);
+
+      for (int face = 0; face < 6; face++) {
+        GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target, targets[pass], 0);
+        moment_blur_program.set("face", face);
+        screen_quad->draw(moment_blur_program);
+      }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  void set_shadow_filter(ShadowFilter filter) {
+    shadow_filter = filter;
+
+    if (prefiltered() && moment_cubemaps.empty()) {
+      moment_depth_cubemap = create_cubemap(MOMENT_MAP_SIZE, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_NEAREST);
+      for (unsigned i = 0; i < lights->size(); i++) {
+        moment_cubemaps.push_back(create_cubemap(MOMENT_MAP_SIZE, GL_RG32F, GL_RG, GL_LINEAR));
+      }
+      moment_blur_cubemap = create_cubemap(MOMENT_MAP_SIZE, GL_RG32F, GL_RG, GL_LINEAR);
+      glGenFramebuffers(1, &moment_blur_fbo);
+    }
+
+    // Hardware PCF samples the depth cubemaps with comparison and bilinear filtering enabled
+    bool compare = filter == ShadowFilter::HardwarePcf;
+    for (unsigned cubemap: depth_cubemaps) {
+      glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, compare ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
+      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+    }
+
+    float exponent = filter == ShadowFilter::Exponential ? ESM_EXPONENT : 0.0f;
+    for (const Program *program: {&shadow_program, &layer_shadow_program, &face_shadow_program}) {
+      if (!program->ready()) continue;
+      program->use();
+      program->set("esmExponent", exponent);
+    }
+    shadow_valid.assign(lights->size(), false);
+  }
+
+  void set_poisson_taps(int taps) {
+    poisson_taps = taps;
+    auto &pcf_programs = *programs[(int) ShadowFilter::HardwarePcf];
+    for (unsigned i = 0; i < LIGHT_LIST_PERMUTATIONS; i++) {
+      pcf_programs[i].use();
+      pcf_programs[i].set("poissonTaps", poisson_taps);
+    }
+  }
 
+  void setup() override {
     camera->position = vec3(0.0, 1.5, 5.0);
 
     // Compile shaders and link cube_program
     // --------------------------------------------
     Shader vertex_shader = Shader::vertex("shaders/point-shadow/vertex.glsl");
-    Shader basic_frag = Shader::fragment("shaders/point-shadow/fragment.glsl");
     Shader light_frag = Shader::fragment("shaders/point-shadow/light_frag.glsl");
 
-    program = Program(vertex_shader, basic_frag);
+    for (int filter = 0; filter < SHADOW_FILTERS; filter++) {
+      std::string defines = "#define SHADOW_FILTER " + std::to_string(filter) + "\n";
+      programs[filter] = std::make_unique<LightListPrograms>(
+        vertex_shader, "shaders/point-shadow/fragment.glsl", defines
+      );
+    }
     light_program = Program(vertex_shader, light_frag);
     shadow_program = Program();
     shadow_program.attach_shader(Shader::vertex("shaders/point-shadow/shadow_vert.glsl"));
@@ -57,32 +326,46 @@ private:
     shadow_program.attach_shader(Shader::fragment("shaders/point-shadow/shadow_frag.glsl"));
     shadow_program.link();
 
-    Shader pp_vertex = Shader::vertex("shaders/common/postprocess/vert.glsl");
-    Shader pp_tonemap[3] = {
-      Shader::fragment("shaders/common/postprocess/frag_tm_none.glsl"),
-      Shader::fragment("shaders/common/postprocess/frag_tm_reinhard.glsl"),
-      Shader::fragment("shaders/common/postprocess/frag_tm_aces.glsl")
-    };
-    for (const auto &tm_frag: pp_tonemap) {
-      post_programs.emplace_back(pp_vertex, tm_frag);
+    face_shadow_program = Program(
+      "shaders/point-shadow/shadow_face_vert.glsl",
+      "shaders/point-shadow/shadow_frag.glsl"
+    );
+
+    moment_blur_program = Program(
+      Shader::vertex("shaders/common/postprocess/vert.glsl"),
+      Shader::fragment(
+        "shaders/point-shadow/moment_blur_frag.glsl", GaussianKernel::from_radius(MOMENT_BLUR_RADIUS).defines()
+      )
+    );
+    moment_blur_program.use();
+    moment_blur_program.set("moments", 0);
+
+    layered_supported = has_extension("GL_ARB_shader_viewport_layer_array");
+    if (layered_supported) {
+      layer_shadow_program = Program(
+        "shaders/point-shadow/shadow_layer_vert.glsl",
+        "shaders/point-shadow/shadow_frag.glsl"
+      );
     }
 
-    camera->set_matrix_binding(program);
+    for (auto &filter_programs: programs) {
+      for (unsigned i = 0; i < LIGHT_LIST_PERMUTATIONS; i++) camera->set_matrix_binding((*filter_programs)[i]);
+    }
     camera->set_matrix_binding(light_program);
 
     // Setup post processing
     // --------------------------------------------
     post_processing = std::make_unique<PostProcessing>(
-      PostProcessing(viewport_width, viewport_height, post_programs[2])
+      PostProcessing(viewport_width, viewport_height, tonemappers[tonemapper_idx])
     );
 
-    PostProcessBloom bloom(viewport_width, viewport_height, 5);
+    PostProcessBloom bloom;
     post_processing->add_stage(bloom);
 
     // Setup objects
     // --------------------------------------------
     room_model = std::make_unique<Model>(Model("assets/brick_container.obj", true));
-    room = std::make_unique<Instance>(Instance(*room_model, program));
+    room = std::make_unique<Instance>(Instance(*room_model, (*programs[0])[0]));
 
     room->transform = translate(room->transform, vec3(0.0f, -5.0f, 0.0f));
     room->transform = scale(room->transform, vec3(10.0f));
@@ -100,62 +383,84 @@ private:
     };
 
     for (const auto &transform: box_transforms) {
-      Instance box(*box_model, program);
+      Instance box(*box_model, (*programs[0])[0]);
       box.transform = transform;
       boxes.push_back(box);
     }
 
     light_model = std::make_unique<Model>(Model("assets/sphere.obj"));
-    light_objs.emplace_back(*light_model, light_program);
-    light_objs.emplace_back(*light_model, light_program);
-
-    // Lights
-    PointLight light0(1, vec3(0.0f), vec3(1.0f, 0.5f, 0.0f) * 100.0f);
-    light0.set_ubo_binding(program, "PointLightBlock0");
-    lights.push_back(light0);
 
-    PointLight light1(2, vec3(0.0f), vec3(0.0f, 0.3f, 1.0f) * 100.0f);
-    light1.set_ubo_binding(program, "PointLightBlock1");
-    lights.push_back(light1);
+    // Lights, past the first two they get spread out colors and dimmer so the room stays about as bright
+    lights = std::make_unique<PointLightBuffer>(light_count);
+    lights->add(PointLight(vec3(0.0f), vec3(1.0f, 0.5f, 0.0f) * 100.0f));
+    if (light_count > 1) lights->add(PointLight(vec3(0.0f), vec3(0.0f, 0.3f, 1.0f) * 100.0f));
+    for (unsigned i = 2; i < light_count; i++) {
+      float hue = (float) i * 2.4f;
+      vec3 color(0.5f + 0.5f * sin(hue), 0.5f + 0.5f * sin(hue + 2.1f), 0.5f + 0.5f * sin(hue + 4.2f));
+      lights->add(PointLight(vec3(0.0f), color * 200.0f / (float) light_count));
+    }
+    for (unsigned i = 0; i < light_count; i++) light_objs.emplace_back(*light_model, light_program);
+    light_spheres.resize(lights->size());
 
     // Setup uniforms
     // --------------------------------------------
-    program.use();
-    program.set("shadowMap0", 10);
-    program.set("shadowMap1", 11);
-    program.set("farPlane", POINT_SHADOW_FAR);
-    program.set("material.shininess", 32.0f);
+    int shadow_units[MAX_OBJECT_LIGHTS];
+    for (int i = 0; i < MAX_OBJECT_LIGHTS; i++) shadow_units[i] = SHADOW_MAP_UNIT + i;
+
+    for (auto &filter_programs: programs) {
+      for (unsigned i = 0; i < LIGHT_LIST_PERMUTATIONS; i++) {
+        const Program &program = (*filter_programs)[i];
+        program.use();
+        program.set("shadowMaps", shadow_units, (int) LightListPrograms::max_lights(i));
+        program.set("pointLights", LIGHT_BUFFER_UNIT);
+        program.set("esmExponent", ESM_EXPONENT);
+        program.set("material.shininess", 32.0f);
+      }
+    }
+    set_poisson_taps(poisson_taps);
+
+    for (const Program *program: {&shadow_program, &layer_shadow_program, &face_shadow_program}) {
+      if (!program->ready()) continue;
+      program->use();
+      program->set("pointLights", LIGHT_BUFFER_UNIT);
+    }
 
-    shadow_program.use();
-    shadow_program.set("farPlane", POINT_SHADOW_FAR);
+    shadow_timer = std::make_unique<GpuTimer>();
+    lighting_timer = std::make_unique<GpuTimer>();
+    shadow_primitives = std::make_unique<GpuCounter>(GL_PRIMITIVES_GENERATED);
 
     // Setup shadow framebuffer
     // --------------------------------------------
-    unsigned depth_cubemap, shadow_depth_fbo;
-    for (unsigned i = 0; i < 2; i++) {
-      glGenTextures(1, &depth_cubemap);
-
-      glBindTexture(GL_TEXTURE_CUBE_MAP, depth_cubemap);
-      for (unsigned f = GL_TEXTURE_CUBE_MAP_POSITIVE_X; f <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z; f++) {
-        glTexImage2D(f, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-      }
-
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // Targets are attached on every update, they depend on the filtering mode
+    unsigned shadow_depth_fbo;
+    for (unsigned i = 0; i < lights->size(); i++) {
+      depth_cubemaps.push_back(create_cubemap(SHADOW_WIDTH, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_NEAREST));
 
       glGenFramebuffers(1, &shadow_depth_fbo);
       glBindFramebuffer(GL_FRAMEBUFFER, shadow_depth_fbo);
-      glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_cubemap, 0);
-      glDrawBuffer(GL_NONE);
       glReadBuffer(GL_NONE);
       glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-      depth_cubemaps.push_back(depth_cubemap);
       shadow_depth_fbos.push_back(shadow_depth_fbo);
     }
+    cached_spheres.resize(lights->size());
+    set_shadow_filter(shadow_filter);
+
+    // Setup screen quad, for blurring the moments
+    // --------------------------------------------
+    std::vector<Vertex> quad_vertices = {
+      {vec3(-1.0f, 1.0f, 0.0f),  vec3(), vec3(), vec2(0.0f, 1.0f)},
+      {vec3(-1.0f, -1.0f, 0.0f), vec3(), vec3(), vec2(0.0f, 0.0f)},
+      {vec3(1.0f, -1.0f, 0.0f),  vec3(), vec3(), vec2(1.0f, 0.0f)},
+      {vec3(1.0f, 1.0f, 0.0f),   vec3(), vec3(), vec2(1.0f, 1.0f)}
+    };
+    std::vector<unsigned> quad_indices = {0, 1, 2, 0, 2, 3};
+    std::vector<Texture> quad_textures;
+    screen_quad = std::make_unique<Mesh>(
+      Mesh(std::move(quad_vertices), std::move(quad_indices), std::move(quad_textures))
+    );
+
+    // Blur taps cross face edges into the neighbouring face
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
     glDepthFunc(GL_LEQUAL);
   }
@@ -163,72 +468,167 @@ private:
   void resize_callback(int width, int height) override {
     Window::resize_callback(width, height);
 
-    post_processing->resize_framebuffers(width, height);
+    post_processing->request_resize(width, height);
   }
 
   void key_callback(int key, int scancode, int action, int mods) override {
     if (action != GLFW_PRESS) return;
 
     if (key == GLFW_KEY_SPACE) {
-      pp_frag_idx = (pp_frag_idx + 1) % post_programs.size();
-      post_processing->final_stage = post_programs[pp_frag_idx];
+      tonemapper_idx = (tonemapper_idx + 1) % tonemappers.size();
+      post_processing->set_tonemapper(tonemappers[tonemapper_idx]);
+    }
+
+    if (key == GLFW_KEY_P) paused = !paused;
+
+    if (key == GLFW_KEY_L) {
+      shadow_path = shadow_path == ShadowPath::GeometryShader ? ShadowPath::Layered
+                    : shadow_path == ShadowPath::Layered ? ShadowPath::PerFace
+                    : ShadowPath::GeometryShader;
+      if (shadow_path == ShadowPath::Layered && !layered_supported) shadow_path = ShadowPath::PerFace;
+
+      const char *names[] = {"geometry shader", "layered instancing", "per-face passes"};
+      std::cout << "Shadow path: " << names[(int) shadow_path] << "\n";
+      shadow_valid.assign(lights->size(), false);
+    }
+
+    if (key == GLFW_KEY_F) {
+      set_shadow_filter((ShadowFilter) (((int) shadow_filter + 1) % SHADOW_FILTERS));
+      std::cout << "Shadow filter: " << filter_name(shadow_filter) << "\n";
     }
+
+    if (key == GLFW_KEY_K) {
+      set_poisson_taps(poisson_taps == 16 ? 4 : poisson_taps * 2);
+      std::cout << "Poisson taps: " << poisson_taps << "\n";
+    }
+
+    if (key == GLFW_KEY_T && !benchmarking) {
+      benchmarking = true;
+      benchmark_frames = 0;
+      set_shadow_filter(ShadowFilter::Manual);
+      std::cout << "Benchmarking lighting pass with " << lights->size() << " lights...\n";
+    }
+  }
+
+  static const char *filter_name(ShadowFilter filter) {
+    const char *names[] = {"manual 20 taps", "hardware PCF", "variance", "exponential"};
+    return names[(int) filter];
+  }
+
+  // Lets each filter settle for BENCHMARK_FRAMES frames, then keeps the lighting pass average
+  void update_benchmark() {
+    if (!benchmarking || ++benchmark_frames < BENCHMARK_FRAMES) return;
+    benchmark_frames = 0;
+    benchmark_ms[(int) shadow_filter] = lighting_timer->average_ms();
+
+    int next = (int) shadow_filter + 1;
+    if (next < SHADOW_FILTERS) {
+      set_shadow_filter((ShadowFilter) next);
+      return;
+    }
+
+    benchmarking = false;
+    std::cout << "Lighting pass, " << lights->size() << " lights, " << poisson_taps << " Poisson taps:\n";
+    for (int filter = 0; filter < SHADOW_FILTERS; filter++) {
+      std::cout << "  " << filter_name((ShadowFilter) filter) << ": " << benchmark_ms[filter] << " ms\n";
+    }
+    set_shadow_filter(ShadowFilter::Manual);
+  }
+
+  void report_shadows() {
+    if (++frames_since_report < 120) return;
+    frames_since_report = 0;
+
+    std::cout << "Shadow maps rendered: " << rendered_maps << "/" << lights->size()
+              << " | shadow primitives: " << shadow_primitives->average_count()
+              << " | shadow pass: " << shadow_timer->average_ms() << " ms"
+              << " | lighting pass (" << filter_name(shadow_filter) << "): " << lighting_timer->average_ms() << " ms\n";
   }
 
   void frame() override {
     // Update lights
-    lights[0].position = vec3(cos(current_frame) * 4.0f, 0.0f, sin(current_frame) * 4.0f);
-    lights[0].update_ubo();
-    light_objs[0].transform = translate(mat4(1.0), lights[0].position);
-    light_objs[0].transform = scale(light_objs[0].transform, vec3(0.05f));
-
-    lights[1].position = vec3(sin(current_frame * 0.5f) * 4.0f, cos(current_frame * 0.5f) * 4.0f, 0.0f);
-    lights[1].update_ubo();
-    light_objs[1].transform = translate(mat4(1.0), lights[1].position);
-    light_objs[1].transform = scale(light_objs[1].transform, vec3(0.05f));
-
-    // Render shadow depth maps
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-
-    for (int i = 0; i < 2; i++) {
-      lights[i].set_ubo_binding(shadow_program, "PointLightBlock");
-      glBindFramebuffer(GL_FRAMEBUFFER, shadow_depth_fbos[i]);
-      glClear(GL_DEPTH_BUFFER_BIT);
-      for (const auto &box: boxes) box.draw_with(shadow_program);
-      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!paused) light_time += delta_time;
+    for (unsigned i = 0; i < lights->size(); i++) {
+      vec3 &position = (*lights)[i].position;
+      if (i == 0) {
+        position = vec3(cos(light_time) * 4.0f, 0.0f, sin(light_time) * 4.0f);
+      } else if (i == 1) {
+        position = vec3(sin(light_time * 0.5f) * 4.0f, cos(light_time * 0.5f) * 4.0f, 0.0f);
+      } else {
+        vec3 axis = normalize(vec3(sin((float) i * 1.3f), cos((float) i * 0.7f), 0.5f));
+        float angle = light_time * (0.3f + 0.1f * (float) (i % 5)) + (float) i;
+        position = vec3(rotate(mat4(1.0), angle, axis) * vec4(cross(axis, vec3(0.0f, 0.0f, 1.0f)) * 4.0f, 1.0f));
+      }
+      light_objs[i].transform = translate(mat4(1.0), position);
+      light_objs[i].transform = scale(light_objs[i].transform, vec3(0.05f));
+    }
+
+    lights->update();
+    lights->bind(LIGHT_BUFFER_UNIT);
+
+    // Per-object light lists
+    for (unsigned i = 0; i < lights->size(); i++) {
+      light_spheres[i] = vec4((*lights)[i].position, (*lights)[i].radius());
     }
+    for (auto &box: boxes) box.assign_lights(light_spheres, MAX_OBJECT_LIGHTS);
+    room->assign_lights(light_spheres, MAX_OBJECT_LIGHTS);
+
+    // Render shadow depth maps, moments are written as they are, never blended
+    glViewport(0, 0, shadow_size(), shadow_size());
+    glDisable(GL_BLEND);
+
+    rendered_maps = 0;
+    shadow_timer->begin();
+    shadow_primitives->begin();
+    for (unsigned i = 0; i < lights->size(); i++) {
+      if (shadow_valid[i] && cached_spheres[i] == light_spheres[i]) continue;
+      shadow_valid[i] = true;
+      cached_spheres[i] = light_spheres[i];
+      rendered_maps++;
+
+      render_shadow_map(i);
+      if (prefiltered()) blur_moments(i);
+    }
+    shadow_primitives->end();
+    shadow_timer->end();
 
-    // Forward rendering pass
+    // Forward rendering pass, blended every frame whatever post-processing left behind
     glViewport(0, 0, viewport_width, viewport_height);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     camera->update_matrices(aspect_ratio());
 
-    program.use();
-    program.set("viewPos", camera->position);
+    for (unsigned i = 0; i < LIGHT_LIST_PERMUTATIONS; i++) {
+      lit_programs()[i].use();
+      lit_programs()[i].set("viewPos", camera->position);
+    }
 
     post_processing->bind_input_framebuffer();
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    for (int i = 0; i < 2; i++) {
-      glActiveTexture(GL_TEXTURE10 + i);
-      glBindTexture(GL_TEXTURE_CUBE_MAP, depth_cubemaps[i]);
-    }
-
-    for (const auto &box: boxes) box.draw();
+    lighting_timer->begin();
+    for (const auto &box: boxes) draw_lit(box);
     for (const auto &light: light_objs) light.draw();
 
     glCullFace(GL_FRONT);
-    room->draw();
+    draw_lit(*room);
     glCullFace(GL_BACK);
+    lighting_timer->end();
     Framebuffer::unbind();
 
     // Postprocessing
     post_processing->run();
+
+    report_shadows();
+    update_benchmark();
   }
 };
 
-int main() {
-  PointShadowWindow window;
+int main(int argc, char *argv[]) {
+  unsigned light_count = argc > 1 ? (unsigned) std::stoul(argv[1]) : 2;
+
+  PointShadowWindow window(light_count);
   window.start();
 
   glfwTerminate();
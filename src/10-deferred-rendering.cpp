@@ -7,42 +7,286 @@
 #include <instance.h>
 #include <window.h>
 #include <light.h>
+#include <light_buffer.h>
 #include <postprocess.h>
+#include <color_lut.h>
+#include <postprocess/auto_exposure.h>
 #include <postprocess/bloom.h>
+#include <command_list.h>
+#include <gpu_timer.h>
+#include <light_clusters.h>
+#include <shadow_atlas.h>
+#include <shadow_budget.h>
+#include <render_graph.h>
+#include <trace.h>
+#include <dynamic_resolution.h>
+#include <algorithm>
 #include <random>
 
 #define WIDTH 800
 #define HEIGHT 600
 
+#define BENCHMARK_FRAMES 240
+#define GRADING_PRESETS 3
 #define N_LIGHTS 10
+#define LIGHT_BUFFER_UNIT 8
+#define CLUSTER_GRID_UNIT 6
+#define CLUSTER_INDEX_UNIT 7
+#define SHADOW_ATLAS_UNIT 10
+#define SHADOW_RECT_UNIT 11
 
 using namespace glm;
 
 struct LightData {
   Instance obj;
-  PointLight light;
-  DepthCubeFramebuffer shadow_buffer;
+  unsigned light;
   vec3 rotation_axis;
-  float rotation_speed, radius;
+  float rotation_speed;
 };
 
 class DeferredRenderingWindow : public Window {
 public:
-  DeferredRenderingWindow() : Window(WIDTH, HEIGHT, "Learn OpenGL 10 — Deferred rendering") {
+  explicit DeferredRenderingWindow(unsigned total_lights = N_LIGHTS, unsigned shadowed_lights = N_LIGHTS)
+    : Window(WIDTH, HEIGHT, "Learn OpenGL 10 — Deferred rendering"),
+      total_lights(total_lights), shadowed_lights(min(shadowed_lights, total_lights)) {
   }
 
 private:
-  Program g_program, light_program, shadow_program, tonemap_program, deferred_program;
+  Program g_program, light_program, shadow_program, deferred_program, cluster_program;
+  Program stencil_program;
+
+  // Program variants for each G-buffer layout (toggled with G) and, for lighting, shadow atlas filter:
+  // 20 manual taps, or hardware PCF over a Poisson disk (toggled with F). Lighting variants are indexed
+  // by compact * 2 + hardware PCF.
+  Program g_variants[2], deferred_variants[4], cluster_variants[4];
+  bool compact_g_buffer = false, hardware_pcf = false;
 
   std::unique_ptr<Model> room_model, box_model, light_model;
   std::unique_ptr<Instance> room;
   std::vector<Instance> boxes;
 
-  std::vector<LightData> lights;
+  // Moving shadow casters, drawn over the cached static shadows every frame
+  std::vector<Instance> dynamic_boxes;
+  std::vector<mat4> dynamic_box_transforms;
 
-  std::unique_ptr<TextureFramebuffer> g_buffer;
+  // Lights 0..lights.size() orbit the room and cast shadows, the rest are static, unshadowed fill lights
+  std::vector<LightData> lights;
+  std::unique_ptr<PointLightBuffer> point_lights;
+
+  // All lights are either drawn as volumes, or assigned to clusters and shaded in a single full-screen
+  // pass. Shadows for both come from the atlas, indexed by light.
+  unsigned total_lights, shadowed_lights;
+  bool clustered = true;
+  std::unique_ptr<LightClusters> clusters;
+  std::vector<vec4> cluster_input;
+
+  // Light volumes are icospheres. With stencil volumes on (toggled with V) each light first marks the
+  // pixels whose surface lies inside its volume, and only those run the lighting shader.
+  std::unique_ptr<Mesh> light_volume;
+  bool stencil_volumes = true;
+  std::vector<GpuCounter> volume_fragments;
+
+  std::unique_ptr<ShadowAtlas> shadow_atlas;
+  std::vector<ShadowRequest> shadow_requests;
+
+  // Shadow update budgets, cycled with B: unlimited, 24 faces per frame, 1 ms per frame
+  std::vector<ShadowBudget> shadow_budgets;
+  unsigned budget_idx = 0;
+  // Profiler frame of the last shadows zone result fed to the budget, or of the last budget switch
+  uint64_t budget_fed_frame = 0;
+
+  bool paused = false;
+  float light_time = 0.0f;
+
+  // G-buffer benchmark, started with T: both layouts render for BENCHMARK_FRAMES frames at 1080p, then 4K.
+  // Bloom runs the full resolution blur for the first third of each step, the same blur with the compute
+  // backend for the second (when supported) and the mip chain for the last.
+  int benchmark_step = -1;
+  unsigned benchmark_frames = 0;
+  bool benchmark_restore_compact = false;
+  BloomMode benchmark_restore_bloom = BloomMode::MipChain;
+  BlurBackend benchmark_restore_backend = BlurBackend::Fragment;
+  double benchmark_geometry_ms[4] = {}, benchmark_lighting_ms[4] = {}, benchmark_read_bytes[4] = {};
+  double benchmark_blur_ms[4] = {}, benchmark_compute_blur_ms[4] = {}, benchmark_mip_chain_ms[4] = {};
+  double cluster_build_ms = 0.0;
+  unsigned frames_since_report = 0;
+
+  // The frame is a render graph, rebuilt when its shape changes (resize, G-buffer layout, lighting mode).
+  // Resize events are debounced; until a burst settles, frames keep rendering at the previous size.
+  // With dynamic resolution on (toggled with R) the graph renders at a scale of it, picked from the
+  // measured GPU frame time, and post-processing upscales (U switches bilinear / edge-aware). All GPU
+  // times come from profiler zones: "frame" around the graph, one per pass and "bloom" nested inside it.
+  RenderGraph render_graph;
+  RenderResource g_position = RenderGraph::none, g_normal = RenderGraph::none, g_albedo = RenderGraph::none;
+  RenderResource scene_depth = RenderGraph::none;
+  ResizeDebouncer resize_debouncer;
+  DynamicResolution dynamic_resolution;
+  bool dynamic_scaling = false;
+  // Profiler frame of the last frame time fed to dynamic resolution, or of the last scale change: results
+  // arrive a few frames late, each one is fed once and those from before a change are skipped
+  uint64_t scale_fed_frame = 0;
   std::unique_ptr<Mesh> screen_quad;
   std::unique_ptr<PostProcessing> post_processing;
+  std::unique_ptr<PostProcessBloom> bloom;
+  std::unique_ptr<PostProcessAutoExposure> auto_exposure;
+  std::unique_ptr<ColorLut> color_lut;
+  unsigned grading_idx = 0;
+
+  // The geometry pass only depends on static state, so it is recorded once and replayed; the graph binds
+  // and clears the G-buffer around it. Shadow tiles
+  // and light volumes change every frame and are recorded on the worker threads, one list per worker.
+  CommandList geometry_list;
+  CommandList dynamic_geometry_list;
+  std::vector<CommandList> static_shadow_lists, dynamic_shadow_lists, light_lists;
+
+  void record_geometry_pass() {
+    geometry_list.clear();
+    for (const auto &box: boxes) box.record(geometry_list);
+    geometry_list.cull_mode(GL_FRONT);
+    room->record(geometry_list);
+    geometry_list.cull_mode(GL_BACK);
+  }
+
+  void record_dynamic_geometry() {
+    dynamic_geometry_list.clear();
+    for (const auto &box: dynamic_boxes) box.record(dynamic_geometry_list);
+  }
+
+  // Size each shadow by how much of the screen the light covers, lights up close get the largest tiles.
+  // Lights whose range is entirely off screen get no tile.
+  void allocate_shadows(const Frustum &frustum) {
+    TRACE_ZONE("Shadow culling");
+    mat4 view = camera->get_view_matrix();
+    float pixels_per_unit = (float) viewport_height / tan(radians(camera->fov) * 0.5f);
+
+    shadow_requests.clear();
+    for (const auto &light: lights) {
+      vec3 position = (*point_lights)[light.light].position;
+      float radius = (*point_lights)[light.light].radius();
+      if (!frustum.intersects_sphere(position, radius)) continue;
+
+      float depth = -(view * vec4(position, 1.0f)).z;
+      float distance = length(position - camera->position);
+
+      float screen_size = distance <= radius ? (float) viewport_height
+                                             : radius / max(depth, camera->near_plane) * pixels_per_unit;
+
+      bool dynamic_casters = false;
+      for (const auto &box: dynamic_boxes) dynamic_casters |= box.bounds().intersects_sphere(position, radius);
+
+      // Among lights of similar size on screen, nearby ones are updated first
+      float importance = screen_size / (1.0f + distance);
+
+      shadow_requests.push_back(
+        {
+          light.light,
+          6,
+          shadow_atlas->resolution_for(screen_size),
+          vec4(position, radius),
+          dynamic_casters,
+          importance
+        }
+      );
+    }
+
+    std::stable_sort(shadow_requests.begin(), shadow_requests.end(), [](const auto &a, const auto &b) {
+      return a.resolution > b.resolution;
+    });
+    shadow_atlas->allocate(
+      shadow_requests,
+      (unsigned) point_lights->size(),
+      shadow_budgets[budget_idx].face_budget()
+    );
+  }
+
+  // Static casters go into tiles that lost their cached map, dynamic casters into every redrawn tile they reach.
+  // Each face only draws the casters inside its quarter of the light's range.
+  void record_shadow_passes() {
+    static_shadow_lists.resize(thread_pool->size());
+    dynamic_shadow_lists.resize(thread_pool->size());
+    for (auto &list: static_shadow_lists) list.clear();
+    for (auto &list: dynamic_shadow_lists) list.clear();
+
+    // Face matrices were cached by the light buffer update, workers only read them
+    const auto &tiles = shadow_atlas->tiles();
+    thread_pool->parallel_for(tiles.size(), [&](size_t begin, size_t end, unsigned worker) {
+      auto &static_list = static_shadow_lists[worker];
+      auto &dynamic_list = dynamic_shadow_lists[worker];
+      for (size_t i = begin; i < end; i++) {
+        const auto &tile = tiles[i];
+        if (tile.pass == ShadowPass::Cached) continue;
+        const auto &light = (*point_lights)[tile.slot];
+        const mat4 &light_matrix = light.shadow_matrices()[tile.face];
+        float radius = light.radius();
+        unsigned face_bit = 1u << tile.face;
+
+        if (tile.pass == ShadowPass::Full) {
+          static_list.viewport(tile.offset.x, tile.offset.y, tile.size, tile.size);
+          static_list.scissor(tile.offset.x, tile.offset.y, tile.size, tile.size);
+          static_list.clear_buffers(GL_DEPTH_BUFFER_BIT);
+          static_list.use_program(shadow_program);
+          static_list.set_uniform("lightIndex", (int) tile.slot);
+          static_list.set_uniform("lightMatrix", light_matrix);
+          for (const auto &box: boxes) {
+            if (!(box.bounds().cube_faces(light.position, radius) & face_bit)) continue;
+            box.record_with(static_list, shadow_program);
+          }
+        }
+
+        if (tile.dynamic_casters) {
+          dynamic_list.viewport(tile.offset.x, tile.offset.y, tile.size, tile.size);
+          dynamic_list.use_program(shadow_program);
+          dynamic_list.set_uniform("lightIndex", (int) tile.slot);
+          dynamic_list.set_uniform("lightMatrix", light_matrix);
+          for (const auto &box: dynamic_boxes) {
+            if (!(box.bounds().cube_faces(light.position, radius) & face_bit)) continue;
+            box.record_with(dynamic_list, shadow_program);
+          }
+        }
+      }
+    });
+  }
+
+  // Every light is drawn as a sphere scaled to its range, skipping those that can't touch the screen.
+  // Stencil ops are set up once for the whole pass, see frame(): in the stencil pass back faces behind the
+  // surface increment, front faces in front of it decrement, and the lighting pass zeroes what it shades.
+  void record_light_volumes(const Frustum &frustum) {
+    TRACE_ZONE("Light volume culling");
+    light_lists.resize(thread_pool->size());
+    for (auto &list: light_lists) list.clear();
+
+    thread_pool->parallel_for(point_lights->size(), [&](size_t begin, size_t end, unsigned worker) {
+      auto &list = light_lists[worker];
+      for (size_t i = begin; i < end; i++) {
+        const auto &light = (*point_lights)[i];
+        float radius = light.radius();
+        if (!frustum.intersects_sphere(light.position, radius)) continue;
+        mat4 transform = scale(translate(mat4(1.0f), light.position), vec3(radius));
+
+        if (stencil_volumes) {
+          list.use_program(stencil_program);
+          list.set_model_matrix(transform);
+          list.color_mask(false);
+          list.set_capability(GL_DEPTH_TEST, true);
+          list.set_cull_face(false);
+          list.stencil_func(GL_ALWAYS, 0, 0);
+          list.draw(*light_volume);
+
+          list.color_mask(true);
+          list.set_capability(GL_DEPTH_TEST, false);
+          list.set_cull_face(true);
+          list.stencil_func(GL_NOTEQUAL, 0, 0xFF);
+        }
+
+        list.use_program(deferred_program);
+        list.set_uniform("lightIndex", (int) i);
+        list.set_model_matrix(transform);
+        list.begin_query(volume_fragments[i]);
+        list.draw(*light_volume);
+        list.end_query(volume_fragments[i]);
+      }
+    });
+  }
 
   void setup() override {
     camera->position = vec3(0.0, 1.5, 5.0);
@@ -50,40 +294,58 @@ private:
     // Compile shaders and link program
     // --------------------------------------------
     Shader vertex_shader = Shader::vertex("shaders/deferred-rendering/g_vert.glsl");
-    Shader g_frag = Shader::fragment("shaders/deferred-rendering/g_frag.glsl");
-    g_program = Program(vertex_shader, g_frag);
+    g_variants[0] = Program(vertex_shader, Shader::fragment("shaders/deferred-rendering/g_frag.glsl"));
+    g_variants[1] = Program(
+      vertex_shader, Shader::fragment("shaders/deferred-rendering/g_frag.glsl", "#define GBUFFER_COMPACT\n")
+    );
 
     Shader light_frag = Shader::fragment("shaders/deferred-rendering/light_frag.glsl");
     light_program = Program(vertex_shader, light_frag);
 
-    shadow_program = Program();
-    shadow_program.attach_shader(Shader::vertex("shaders/point-shadow/shadow_vert.glsl"));
-    shadow_program.attach_shader(Shader::geometry("shaders/point-shadow/shadow_geom.glsl"));
-    shadow_program.attach_shader(Shader::fragment("shaders/point-shadow/shadow_frag.glsl"));
-    shadow_program.link();
-
-    tonemap_program = Program("shaders/common/postprocess/vert.glsl", "shaders/common/postprocess/frag_tm_aces.glsl");
-
-    deferred_program = Program("shaders/deferred-rendering/d_vert.glsl", "shaders/deferred-rendering/d_frag.glsl");
+    shadow_program = Program("shaders/point-shadow/shadow_face_vert.glsl", "shaders/point-shadow/shadow_frag.glsl");
+
+    Shader d_vert = Shader::vertex("shaders/deferred-rendering/d_vert.glsl");
+    stencil_program = Program(d_vert, Shader::fragment("shaders/deferred-rendering/stencil_frag.glsl"));
+    Shader pp_vert = Shader::vertex("shaders/common/postprocess/vert.glsl");
+    // Both resolves share G-buffer decoding, shadows and the point light, prepended to their own main()
+    std::string light_common = Shader::read_source("shaders/deferred-rendering/light_common.glsl");
+    for (int i = 0; i < 4; i++) {
+      std::string defines = std::string(i & 2 ? "#define GBUFFER_COMPACT\n" : "")
+                            + (i & 1 ? "#define SHADOW_HARDWARE_PCF\n" : "") + light_common;
+      deferred_variants[i] = Program(d_vert, Shader::fragment("shaders/deferred-rendering/d_frag.glsl", defines));
+      cluster_variants[i] = Program(pp_vert, Shader::fragment("shaders/deferred-rendering/cluster_frag.glsl", defines));
+    }
 
-    camera->set_matrix_binding(g_program);
+    for (const auto &program: g_variants) camera->set_matrix_binding(program);
     camera->set_matrix_binding(light_program);
-    camera->set_matrix_binding(deferred_program);
-
-    // Setup G_Buffer
-    // --------------------------------------------
-    g_buffer = std::make_unique<TextureFramebuffer>(
-      TextureFramebuffer(viewport_width, viewport_height, std::vector<GLint>{GL_RGBA32F, GL_RGBA32F, GL_RGBA})
-    );
+    camera->set_matrix_binding(stencil_program);
+    for (const auto &program: deferred_variants) camera->set_matrix_binding(program);
+    for (const auto &program: cluster_variants) camera->set_matrix_binding(program);
 
-    // Setup post processing
+    // Setup post processing, the lighting passes render into its input over the G-buffer depth
     // --------------------------------------------
     post_processing = std::make_unique<PostProcessing>(
-      PostProcessing(viewport_width, viewport_height, tonemap_program)
+      PostProcessing(
+        viewport_width,
+        viewport_height,
+        "shaders/common/postprocess/pointwise/tm_none.glsl",
+        DepthAttachment::None
+      )
     );
 
-    PostProcessBloom bloom(viewport_width, viewport_height, 5);
-    post_processing->add_stage(bloom);
+    // Bloom mode toggled with M: mip chain or full resolution blur
+    bloom = std::make_unique<PostProcessBloom>();
+    bloom->set_profiler(gpu_profiler.get());
+    post_processing->add_stage(std::ref(*bloom));
+
+    // Exposure measured after bloom, applied with the vignette and tonemapper in the final pass
+    auto_exposure = std::make_unique<PostProcessAutoExposure>();
+    auto_exposure->add_to(*post_processing);
+    post_processing->add_pointwise_stage("shaders/common/postprocess/pointwise/vignette.glsl");
+
+    // Tone curve and grading baked into a LUT, the final pass's only tonemapping cost. L cycles presets.
+    color_lut = std::make_unique<ColorLut>(grading_preset(grading_idx));
+    color_lut->add_to(*post_processing);
 
     // Setup objects
     // --------------------------------------------
@@ -111,55 +373,103 @@ private:
       boxes.push_back(box);
     }
 
+    Instance spinning_box(*box_model, g_program);
+    spinning_box.transform = translate(mat4(1.0f), vec3(1.5f, -3.5f, 1.0f));
+    dynamic_boxes.push_back(spinning_box);
+    dynamic_box_transforms.push_back(spinning_box.transform);
+
     // Setup lights
     // --------------------------------------------
 
     light_model = std::make_unique<Model>(Model("assets/sphere.obj"));
+    light_volume = std::make_unique<Mesh>(Mesh::icosphere(1));
+    point_lights = std::make_unique<PointLightBuffer>(max(total_lights, 1u));
 
     std::random_device r;
     std::default_random_engine e1(r());
     std::uniform_real_distribution<float> col(0.1f, 1.0f);
     std::uniform_real_distribution<float> pos(-1.0f, 1.0f);
 
-    for (unsigned i = 0; i < N_LIGHTS; i++) {
+    for (unsigned i = 0; i < shadowed_lights; i++) {
       vec3 light_color(col(e1), col(e1), col(e1));
       vec3 rotation_axis(pos(e1), pos(e1), pos(e1));
       float rotation_speed = (0.5f + col(e1)) * 45.0f;
 
-      PointLight light(1 + i, vec3(0.0f), light_color * 10.0f);
+      PointLight light(vec3(0.0f), light_color * 10.0f);
       Instance light_obj(*light_model, light_program);
-      DepthCubeFramebuffer shadow_buffer(SHADOW_WIDTH, SHADOW_HEIGHT);
-
-      float threshold = 5.0f / 256.0f;
-      float i_max = max(light.diffuse.x, max(light.diffuse.y, light.diffuse.z));
-      float a = light.attenuation.z, b = light.attenuation.y;
-      float c = light.attenuation.x - i_max / threshold;
-      float radius = (-b + sqrt(b * b - 4 * a * c)) / (2 * a);
 
       lights.push_back(
         {
           light_obj,
-          light,
-          shadow_buffer,
+          point_lights->add(light),
           normalize(rotation_axis),
-          rotation_speed,
-          radius
+          rotation_speed
         }
       );
     }
 
+    // Fill lights get a shorter range the more of them there are, so the room stays lit about the same
+    unsigned num_fill_lights = total_lights - shadowed_lights;
+    float fill_range = clamp(4.0f / std::cbrt((float) max(num_fill_lights, 1u) / 10.0f), 0.5f, 4.0f);
+    std::uniform_real_distribution<float> room_pos(-4.5f, 4.5f);
+
+    for (unsigned i = 0; i < num_fill_lights; i++) {
+      vec3 light_color(col(e1), col(e1), col(e1));
+      float i_max = max(light_color.x, max(light_color.y, light_color.z));
+      float quadratic = (i_max / (5.0f / 256.0f) - 1.0f) / (fill_range * fill_range);
+
+      PointLight light(
+        vec3(room_pos(e1), room_pos(e1), room_pos(e1)),
+        light_color * 0.01f,
+        light_color,
+        light_color,
+        vec3(1.0f, 0.0f, quadratic)
+      );
+      point_lights->add(light);
+    }
+
+    clusters = std::make_unique<LightClusters>();
+    shadow_atlas = std::make_unique<ShadowAtlas>(ShadowAtlas());
+    report_shadow_memory();
+
+    shadow_budgets.push_back(ShadowBudget::faces(UINT_MAX));
+    shadow_budgets.push_back(ShadowBudget::faces(24));
+    shadow_budgets.push_back(ShadowBudget::milliseconds(1.0));
+    volume_fragments.reserve(point_lights->size());
+    for (unsigned i = 0; i < point_lights->size(); i++) volume_fragments.emplace_back(GL_SAMPLES_PASSED);
+
     // Setup uniforms
     // --------------------------------------------
-    deferred_program.use();
-    deferred_program.set("gPosition", 0);
-    deferred_program.set("gNormal", 1);
-    deferred_program.set("gAlbedoSpec", 2);
-
-    deferred_program.set("shadowMap", 10);
-    deferred_program.set("farPlane", POINT_SHADOW_FAR);
+    for (const auto &program: deferred_variants) {
+      program.use();
+      program.set("gPosition", 0);
+      program.set("gNormal", 1);
+      program.set("gAlbedoSpec", 2);
+      program.set("gDepth", 3);
+
+      program.set("shadowAtlas", SHADOW_ATLAS_UNIT);
+      program.set("shadowRects", SHADOW_RECT_UNIT);
+      program.set("pointLights", LIGHT_BUFFER_UNIT);
+      program.set("poissonTaps", 8);
+    }
 
     shadow_program.use();
-    shadow_program.set("farPlane", POINT_SHADOW_FAR);
+    shadow_program.set("pointLights", LIGHT_BUFFER_UNIT);
+
+    for (const auto &program: cluster_variants) {
+      program.use();
+      program.set("gPosition", 0);
+      program.set("gNormal", 1);
+      program.set("gAlbedoSpec", 2);
+      program.set("gDepth", 3);
+      program.set("pointLights", LIGHT_BUFFER_UNIT);
+      program.set("clusterOffsets", CLUSTER_GRID_UNIT);
+      program.set("clusterLights", CLUSTER_INDEX_UNIT);
+      program.set("shadowAtlas", SHADOW_ATLAS_UNIT);
+      program.set("shadowRects", SHADOW_RECT_UNIT);
+      program.set("poissonTaps", 8);
+    }
+    select_programs();
 
     // Setup screen quad
     // --------------------------------------------
@@ -175,105 +485,528 @@ private:
       Mesh(std::move(quad_vertices), std::move(quad_indices), std::move(quad_textures))
     );
 
+    // Record static passes and build the frame
+    // --------------------------------------------
+    record_geometry_pass();
+    build_render_graph(viewport_width, viewport_height);
+    render_graph.set_profiler(gpu_profiler.get());
+
     glDepthFunc(GL_LEQUAL);
   }
 
+  // Shadows, geometry, lighting, forward lights and post-processing. The G-buffer is transient: wide is
+  // RGBA32F position, RGBA32F normal and RGBA8 albedo/spec, 40 bytes per pixel with depth-stencil; compact
+  // is RG16 octahedral normal and RGBA8 albedo/spec, 12 bytes. Its depth is shared with the lighting and
+  // forward passes; the compact layout also samples it, so light volumes (which attach it) read a copy.
+  void build_render_graph(int width, int height) {
+    render_graph.reset();
+
+    RenderResource atlas = render_graph.import_texture(
+      "shadow atlas", shadow_atlas->depth_map(), shadow_atlas->size(), shadow_atlas->size()
+    );
+    RenderResource lit = render_graph.import_texture("lit", post_processing->input_texture(), width, height);
+    scene_depth = render_graph.create_depth("scene depth", width, height);
+    g_position = RenderGraph::none;
+    if (!compact_g_buffer) g_position = render_graph.create_texture("position", width, height, GL_RGBA32F);
+    g_normal = render_graph.create_texture("normal", width, height, compact_g_buffer ? GL_RG16 : GL_RGBA32F);
+    g_albedo = render_graph.create_texture("albedo", width, height, GL_RGBA);
+
+    render_graph.add_pass("shadows", [this](const RenderGraph &) { render_shadows(); }).write(atlas);
+
+    auto geometry = render_graph.add_pass("geometry", [this](const RenderGraph &) {
+      geometry_list.replay();
+      dynamic_geometry_list.replay();
+    });
+    if (!compact_g_buffer) geometry.color(g_position);
+    geometry.color(g_normal).color(g_albedo).depth(scene_depth);
+    geometry.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    auto lighting = render_graph.add_pass("lighting", [this](const RenderGraph &graph) { render_lighting(graph); });
+    lighting.read(atlas).read(g_normal).read(g_albedo).read(compact_g_buffer ? scene_depth : g_position);
+    lighting.color(lit).clear(clustered ? GL_COLOR_BUFFER_BIT : GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    if (!clustered) lighting.depth(scene_depth);
+
+    render_graph.add_pass("forward", [this](const RenderGraph &) {
+      for (auto &light: lights) {
+        light.obj.transform = scale(light.obj.transform, vec3(0.05f));
+        light.obj.draw();
+      }
+    }).color(lit).depth(scene_depth);
+
+    auto post = [this](const RenderGraph &) {
+      color_lut->bind();
+      post_processing->run();
+    };
+    render_graph.add_pass("post", post).read(lit).to_screen();
+
+    render_graph.compile();
+
+    auto mib = [](size_t bytes) { return (double) bytes / (1024.0 * 1024.0); };
+    std::cout << "Render graph: " << render_graph.pass_count() << " passes (" << render_graph.culled_count()
+              << " culled), " << render_graph.transient_count() << " transient textures in "
+              << render_graph.texture_count() << " allocations, " << mib(render_graph.memory_bytes()) << " MiB\n";
+  }
+
+  unsigned g_buffer_bytes_per_pixel() const {
+    return compact_g_buffer ? 12 : 40;
+  }
+
+  void bind_g_buffer(const RenderGraph &graph) const {
+    if (compact_g_buffer) {
+      graph.bind_texture(g_normal, 1);
+      graph.bind_texture(g_albedo, 2);
+      graph.bind_texture(scene_depth, 3);
+    } else {
+      graph.bind_texture(g_position, 0);
+      graph.bind_texture(g_normal, 1);
+      graph.bind_texture(g_albedo, 2);
+    }
+  }
+
+  void select_programs() {
+    int variant = (compact_g_buffer ? 2 : 0) + (hardware_pcf ? 1 : 0);
+    g_program = g_variants[compact_g_buffer];
+    deferred_program = deferred_variants[variant];
+    cluster_program = cluster_variants[variant];
+    shadow_atlas->set_compare(hardware_pcf);
+  }
+
+  void set_compact_g_buffer(bool compact, int width, int height) {
+    compact_g_buffer = compact;
+    select_programs();
+    build_render_graph(width, height);
+  }
+
   void resize_callback(int width, int height) override {
     Window::resize_callback(width, height);
 
+    resize_debouncer.request(width, height);
+  }
+
+  void resize_render_targets(int width, int height) {
     post_processing->resize_framebuffers(width, height);
+    build_render_graph(post_processing->render_width(), post_processing->render_height());
+  }
+
+  void set_render_scale(float scale) {
+    scale_fed_frame = gpu_profiler->frame();
+    post_processing->set_render_scale(scale);
+    build_render_graph(post_processing->render_width(), post_processing->render_height());
+  }
+
+  // The millisecond budget converts the shadows pass time into faces, each result is fed once
+  void update_shadow_budget() {
+    const ZoneStats *shadows = gpu_profiler->zone("shadows");
+    if (!shadows || shadows->last_frame() <= budget_fed_frame) return;
+
+    budget_fed_frame = shadows->last_frame();
+    shadow_budgets[budget_idx].add_time(shadows->last_ms());
+  }
+
+  // The scale only changes once the frame time has left the target band for a while, see DynamicResolution
+  void update_render_scale() {
+    if (!dynamic_scaling || benchmark_step >= 0) return;
+    const ZoneStats *frame = gpu_profiler->zone("frame");
+    if (!frame || frame->last_frame() <= scale_fed_frame) return;
+
+    scale_fed_frame = frame->last_frame();
+    if (dynamic_resolution.update(frame->last_ms())) set_render_scale(dynamic_resolution.scale());
+  }
+
+  void key_callback(int key, int scancode, int action, int mods) override {
+    if (action != GLFW_PRESS) return;
 
-    g_buffer->free();
-    g_buffer = std::make_unique<TextureFramebuffer>(
-      TextureFramebuffer(width, height, std::vector<GLint>{GL_RGBA32F, GL_RGBA32F, GL_RGBA})
+    if (key == GLFW_KEY_C) {
+      clustered = !clustered;
+      std::cout << "Lighting: " << (clustered ? "clustered" : "light volumes") << "\n";
+      build_render_graph(viewport_width, viewport_height);
+    }
+
+    if (key == GLFW_KEY_P) paused = !paused;
+
+    if (key == GLFW_KEY_B) {
+      budget_idx = (budget_idx + 1) % shadow_budgets.size();
+      budget_fed_frame = gpu_profiler->frame();
+      const char *names[] = {"unlimited", "24 faces", "1 ms"};
+      std::cout << "Shadow budget: " << names[budget_idx] << "\n";
+    }
+
+    if (key == GLFW_KEY_V) {
+      stencil_volumes = !stencil_volumes;
+      std::cout << "Stencil light volumes: " << (stencil_volumes ? "on" : "off") << "\n";
+    }
+
+    if (key == GLFW_KEY_G && benchmark_step < 0) {
+      set_compact_g_buffer(!compact_g_buffer, viewport_width, viewport_height);
+      std::cout << "G-buffer: " << (compact_g_buffer ? "compact" : "wide") << ", "
+                << g_buffer_bytes_per_pixel() << " bytes per pixel\n";
+    }
+
+    if (key == GLFW_KEY_T && benchmark_step < 0) {
+      std::cout << "Benchmarking G-buffer layouts...\n";
+      start_benchmark_step(0);
+    }
+
+    if (key == GLFW_KEY_R && benchmark_step < 0) {
+      dynamic_scaling = !dynamic_scaling;
+      dynamic_resolution.reset();
+      set_render_scale(dynamic_resolution.scale());
+      std::cout << "Dynamic resolution: " << (dynamic_scaling ? "on" : "off")
+                << ", target " << dynamic_resolution.target() << " ms\n";
+    }
+
+    if (key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET) {
+      double target = dynamic_resolution.target() + (key == GLFW_KEY_LEFT_BRACKET ? -1.0 : 1.0);
+      dynamic_resolution.set_target(max(target, 1.0));
+      std::cout << "Target GPU frame time: " << dynamic_resolution.target() << " ms\n";
+    }
+
+    if (key == GLFW_KEY_U) {
+      bool edge_aware = post_processing->upscaler() == Upscaler::EdgeAware;
+      post_processing->set_upscaler(edge_aware ? Upscaler::Bilinear : Upscaler::EdgeAware);
+      std::cout << "Upscaler: " << (edge_aware ? "bilinear" : "edge-aware") << "\n";
+    }
+
+    if (key == GLFW_KEY_M && benchmark_step < 0) {
+      bool mip_chain = bloom->mode() == BloomMode::MipChain;
+      bloom->set_mode(mip_chain ? BloomMode::Blur : BloomMode::MipChain);
+      std::cout << "Bloom: " << (mip_chain ? "full resolution blur" : "mip chain") << "\n";
+    }
+
+    if (key == GLFW_KEY_K && benchmark_step < 0) {
+      bool compute = bloom->backend() == BlurBackend::Compute;
+      bloom->set_backend(compute ? BlurBackend::Fragment : BlurBackend::Compute);
+      std::cout << "Bloom blur backend: " << (bloom->backend() == BlurBackend::Compute ? "compute" : "fragment")
+                << (bloom->compute_supported() ? "" : " (compute shaders need GL 4.3)") << "\n";
+    }
+
+    if (key == GLFW_KEY_J) {
+      Trace::capture(120);
+      std::cout << "Capturing 120 frames to trace.json\n";
+    }
+
+    if (key == GLFW_KEY_O) {
+      gpu_profile_interval = gpu_profile_interval ? 0 : 240;
+      std::cout << "Per-pass GPU profile: " << (gpu_profile_interval ? "every 240 frames" : "off") << "\n";
+    }
+
+    if (key == GLFW_KEY_X) {
+      if (render_stats_log.is_open())
+        render_stats_log.close();
+      else
+        render_stats_log.open("render_stats.csv", 60);
+      std::cout << "Render stats log: " << (render_stats_log.is_open() ? "render_stats.csv, every 60 frames" : "off")
+                << "\n";
+    }
+
+    if (key == GLFW_KEY_L) {
+      grading_idx = (grading_idx + 1) % GRADING_PRESETS;
+      color_lut->set_grading(grading_preset(grading_idx));
+      color_lut->bind();
+      const char *names[] = {"neutral ACES", "neutral Reinhard", "warm ACES"};
+      std::cout << "Grading: " << names[grading_idx] << ", LUT baked in " << color_lut->last_bake_ms()
+                << " ms (" << color_lut->bakes() << " bakes)\n";
+    }
+
+    if (key == GLFW_KEY_F) {
+      hardware_pcf = !hardware_pcf;
+      select_programs();
+      std::cout << "Shadow filter: " << (hardware_pcf ? "hardware PCF" : "manual 20 taps") << "\n";
+    }
+  }
+
+  void build_clusters() {
+    TRACE_ZONE("Cluster build");
+    auto start = (float) glfwGetTime();
+
+    cluster_input.resize(point_lights->size());
+    for (unsigned i = 0; i < point_lights->size(); i++) {
+      const auto &light = (*point_lights)[i];
+      cluster_input[i] = vec4(light.position, light.radius());
+    }
+
+    clusters->build(
+      cluster_input,
+      camera->get_view_matrix(),
+      camera->get_projection_matrix(aspect_ratio()),
+      camera->near_plane,
+      camera->far_plane,
+      *thread_pool
     );
+
+    cluster_build_ms = ((float) glfwGetTime() - start) * 1000.0;
   }
 
-  void frame() override {
-    // Update lights
-    for (auto &light: lights) {
-      light.obj.transform = rotate(mat4(1.0), radians(current_frame * light.rotation_speed), light.rotation_axis);
-      light.obj.transform = translate(light.obj.transform, vec3(0.0, 0.0, 4.0));
+  static ColorGrading grading_preset(unsigned idx) {
+    ColorGrading grading;
+    if (idx == 1) grading.curve = ToneCurve::Reinhard;
+    if (idx == 2) {
+      grading.white_balance = vec3(1.08f, 1.0f, 0.9f);
+      grading.contrast = 1.15f;
+      grading.saturation = 1.2f;
+      grading.lift = vec3(0.01f, 0.0f, 0.02f);
+    }
+    return grading;
+  }
 
-      light.light.position = vec3(light.obj.transform * vec4(0.0, 0.0, 0.0, 1.0));
-      light.light.update_ubo();
+  static ivec2 benchmark_size(int step) {
+    return step < 2 ? ivec2(1920, 1080) : ivec2(3840, 2160);
+  }
+
+  // The window keeps its size, every step renders offscreen at its benchmark resolution
+  void start_benchmark_step(int step) {
+    if (step == 0) {
+      benchmark_restore_compact = compact_g_buffer;
+      benchmark_restore_bloom = bloom->mode();
+      benchmark_restore_backend = bloom->backend();
+      dynamic_resolution.reset();
+      post_processing->set_render_scale(1.0f);
     }
+    benchmark_step = step;
+    benchmark_frames = 0;
+
+    ivec2 size = benchmark_size(step);
+    viewport_width = size.x;
+    viewport_height = size.y;
+    post_processing->resize_framebuffers(size.x, size.y);
+    set_compact_g_buffer(step % 2 == 1, size.x, size.y);
+    bloom->set_mode(BloomMode::Blur);
+    bloom->set_backend(BlurBackend::Fragment);
+    gpu_profiler->clear();
+  }
 
-    // Render shadow depth maps
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+  // G-buffer bytes read by the lighting pass: once per pixel when clustered, once per shaded fragment of
+  // every light volume otherwise
+  double g_buffer_read_bytes() const {
+    double reads = (double) viewport_width * viewport_height;
+    if (!clustered) {
+      reads = 0.0;
+      for (const auto &counter: volume_fragments) reads += counter.average_count();
+    }
+    return reads * g_buffer_bytes_per_pixel();
+  }
 
-    for (auto &light: lights) {
-      light.shadow_buffer.bind();
-      glClear(GL_DEPTH_BUFFER_BIT);
-      light.light.set_ubo_binding(shadow_program, "PointLightBlock");
-      for (const auto &box: boxes) box.draw_with(shadow_program);
+  void update_benchmark() {
+    if (benchmark_step < 0) return;
+    if (++benchmark_frames == BENCHMARK_FRAMES / 3) {
+      benchmark_blur_ms[benchmark_step] = zone_ms("bloom");
+      bloom->set_backend(BlurBackend::Compute);
+      gpu_profiler->clear();
+    }
+    if (benchmark_frames == 2 * BENCHMARK_FRAMES / 3) {
+      benchmark_compute_blur_ms[benchmark_step] = zone_ms("bloom");
+      bloom->set_mode(BloomMode::MipChain);
+      gpu_profiler->clear();
+    }
+    // Zones are cleared at every switch, geometry and lighting are averaged over the last third
+    if (benchmark_frames < BENCHMARK_FRAMES) return;
+    benchmark_mip_chain_ms[benchmark_step] = zone_ms("bloom");
+    benchmark_geometry_ms[benchmark_step] = zone_ms("geometry");
+    benchmark_lighting_ms[benchmark_step] = zone_ms("lighting");
+    benchmark_read_bytes[benchmark_step] = g_buffer_read_bytes();
+
+    if (benchmark_step < 3) {
+      start_benchmark_step(benchmark_step + 1);
+      return;
     }
-    Framebuffer::unbind();
 
-    // Geometry pass
-    glViewport(0, 0, viewport_width, viewport_height);
-    camera->update_matrices(aspect_ratio());
+    auto mib = [](double bytes) { return bytes / (1024.0 * 1024.0); };
+    std::cout << "G-buffer benchmark (" << (clustered ? "clustered" : "volumes") << "):\n";
+    for (int step = 0; step < 4; step++) {
+      ivec2 size = benchmark_size(step);
+      unsigned bytes_per_pixel = step % 2 == 1 ? 12 : 40;
+      double written = (double) size.x * size.y * bytes_per_pixel;
+
+      std::cout << "  " << (step < 2 ? "1080p " : "4K    ") << (step % 2 == 1 ? "compact" : "wide   ")
+                << " | " << bytes_per_pixel << " B/px | written " << mib(written) << " MiB"
+                << " | read " << mib(benchmark_read_bytes[step]) << " MiB"
+                << " | geometry pass " << benchmark_geometry_ms[step] << " ms"
+                << " | lighting pass " << benchmark_lighting_ms[step] << " ms"
+                << " | bloom: blur " << benchmark_blur_ms[step] << " ms, compute blur ";
+      if (bloom->compute_supported()) {
+        std::cout << benchmark_compute_blur_ms[step] << " ms";
+      } else {
+        std::cout << "n/a";
+      }
+      std::cout << ", mip chain " << benchmark_mip_chain_ms[step] << " ms\n";
+    }
 
-    g_buffer->bind();
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    for (const auto &box: boxes) box.draw();
-    glCullFace(GL_FRONT);
-    room->draw();
-    glCullFace(GL_BACK);
+    benchmark_step = -1;
+    int width, height;
+    glfwGetFramebufferSize(glfw_window, &width, &height);
+    compact_g_buffer = benchmark_restore_compact;
+    bloom->set_mode(benchmark_restore_bloom);
+    bloom->set_backend(benchmark_restore_backend);
+    select_programs();
+    resize_render_targets(width, height);
+  }
+
+  // The atlas is a fixed cost, separate depth cubemaps grow with the number of shadowed lights
+  void report_shadow_memory() const {
+    auto mib = [](size_t bytes) { return (double) bytes / (1024.0 * 1024.0); };
+    size_t cube_bytes = (size_t) SHADOW_WIDTH * SHADOW_HEIGHT * 6 * sizeof(float);
+
+    std::cout << "Shadow atlas: " << shadow_atlas->size() << "x" << shadow_atlas->size() << ", "
+              << mib(shadow_atlas->memory_bytes()) << " MiB | depth cubemaps:";
+    for (unsigned n: {10u, 50u, 100u}) std::cout << " " << n << " lights " << mib(n * cube_bytes) << " MiB";
+    std::cout << "\n";
+  }
+
+  // Average of a profiler zone, 0 until its first result arrives
+  double zone_ms(const char *name) const {
+    const ZoneStats *zone = gpu_profiler->zone(name);
+    return zone ? zone->average_ms() : 0.0;
+  }
+
+  void report_timings() {
+    if (++frames_since_report < 120) return;
+    frames_since_report = 0;
+
+    std::cout << "Lights: " << point_lights->size()
+              << " | shadow tiles: " << shadow_atlas->tiles().size()
+              << " | shadow maps rendered: " << shadow_atlas->rendered_maps()
+              << " (" << shadow_atlas->rendered_faces() << " faces)"
+              << " | lighting: " << (clustered ? "clustered" : "volumes")
+              << " | cluster build: " << (clustered ? cluster_build_ms : 0.0) << " ms"
+              << " | G-buffer: " << (compact_g_buffer ? "compact" : "wide")
+              << " | lighting pass (" << (hardware_pcf ? "PCF" : "manual") << "): "
+              << zone_ms("lighting") << " ms"
+              << " | bloom: " << zone_ms("bloom") << " ms"
+              << " | post passes: " << post_processing->fullscreen_passes()
+              << " | draws: " << render_stats().draw_calls << " (" << render_stats().primitives << " triangles)"
+              << " | GPU frame: " << zone_ms("frame") << " ms at "
+              << (int) (post_processing->render_scale() * 100.0f) << "% scale"
+              << " | frame: " << delta_time * 1000.0f << " ms\n";
+
+    if (!clustered) report_volume_fragments();
+  }
+
+  // Fragments that ran the lighting shader per light volume, averaged over recent frames
+  void report_volume_fragments() const {
+    double total = 0.0, most = 0.0;
+    for (const auto &counter: volume_fragments) {
+      total += counter.average_count();
+      most = max(most, counter.average_count());
+    }
+
+    std::cout << "Shaded fragments per light (stencil " << (stencil_volumes ? "on" : "off") << "): average "
+              << (unsigned) (total / (double) max(volume_fragments.size(), (size_t) 1)) << ", max " << (unsigned) most;
+    for (unsigned i = 0; i < lights.size() && i < 8; i++) {
+      std::cout << (i == 0 ? " | shadowed lights:" : "") << " " << (unsigned) volume_fragments[i].average_count();
+    }
+    std::cout << "\n";
+  }
+
+  // Static casters, then the static layer is copied under the dynamic ones
+  void render_shadows() {
+    shadow_atlas->static_target().bind();
+    glEnable(GL_SCISSOR_TEST);
+    CommandList::replay(static_shadow_lists);
+    glDisable(GL_SCISSOR_TEST);
+
+    shadow_atlas->restore_static();
+    shadow_atlas->target().bind();
+    CommandList::replay(dynamic_shadow_lists);
     Framebuffer::unbind();
+    shadow_budgets[budget_idx].add_faces(shadow_atlas->rendered_faces());
+  }
 
-    // Deferred lighting pass
-    post_processing->bind_input_framebuffer();
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+  // The graph has bound the lighting target and cleared it (and the stencil, for light volumes)
+  void render_lighting(const RenderGraph &graph) {
+    // Only read by the compact layout, to reconstruct positions from depth
+    mat4 inverse_view_projection = inverse(camera->get_projection_matrix(aspect_ratio()) * camera->get_view_matrix());
+    cluster_program.use();
+    cluster_program.set_matrix("inverseViewProjection", inverse_view_projection);
 
     deferred_program.use();
     deferred_program.set("viewPos", camera->position);
-    g_buffer->bind_texture(0, 0);
-    g_buffer->bind_texture(1, 1);
-    g_buffer->bind_texture(2, 2);
+    deferred_program.set_matrix("inverseViewProjection", inverse_view_projection);
+    bind_g_buffer(graph);
+    shadow_atlas->bind(SHADOW_ATLAS_UNIT, SHADOW_RECT_UNIT);
 
     glEnable(GL_BLEND);
     glDisable(GL_DEPTH_TEST);
     glBlendFunc(GL_ONE, GL_ONE);
-    glCullFace(GL_FRONT);
-    for (auto &light: lights) {
-      light.light.set_ubo_binding(deferred_program, "PointLightBlock");
-      glActiveTexture(GL_TEXTURE10);
-      glBindTexture(GL_TEXTURE_CUBE_MAP, light.shadow_buffer.depth_map());
-
-      light.obj.transform = scale(light.obj.transform, vec3(light.radius));
-      light.obj.draw_with(deferred_program);
+    if (!clustered) {
+      glCullFace(GL_FRONT);
+      if (stencil_volumes) {
+        glEnable(GL_STENCIL_TEST);
+        glDepthMask(GL_FALSE);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_ZERO);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+      }
+      CommandList::replay(light_lists);
+      if (stencil_volumes) {
+        glDisable(GL_STENCIL_TEST);
+        glDepthMask(GL_TRUE);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+      }
+      glEnable(GL_CULL_FACE);
+      glCullFace(GL_BACK);
+    } else {
+      cluster_program.use();
+      cluster_program.set("viewPos", camera->position);
+      clusters->set_uniforms(cluster_program, viewport_width, viewport_height);
+      clusters->bind(CLUSTER_GRID_UNIT, CLUSTER_INDEX_UNIT);
+      screen_quad->draw(cluster_program);
     }
-    glCullFace(GL_BACK);
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_BLEND);
+  }
 
-    // Forward rendering pass (lights)
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, g_buffer->id());
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, post_processing->input_framebuffer());
-    glBlitFramebuffer(
-      0, 0, viewport_width, viewport_height,
-      0, 0, viewport_width, viewport_height,
-      GL_DEPTH_BUFFER_BIT, GL_NEAREST
-    );
-    post_processing->bind_input_framebuffer();
+  void frame() override {
+    int width, height;
+    if (benchmark_step < 0 && resize_debouncer.poll(width, height)) resize_render_targets(width, height);
+
+    ivec2 size = benchmark_step >= 0 ? benchmark_size(benchmark_step)
+                                     : ivec2(post_processing->render_width(), post_processing->render_height());
+    viewport_width = size.x;
+    viewport_height = size.y;
 
+    // Update lights and dynamic objects
+    if (!paused) light_time += delta_time;
     for (auto &light: lights) {
-      light.obj.transform = scale(light.obj.transform, vec3(0.05f / light.radius));
-      light.obj.draw();
+      light.obj.transform = rotate(mat4(1.0), radians(light_time * light.rotation_speed), light.rotation_axis);
+      light.obj.transform = translate(light.obj.transform, vec3(0.0, 0.0, 4.0));
+
+      (*point_lights)[light.light].position = vec3(light.obj.transform * vec4(0.0, 0.0, 0.0, 1.0));
     }
+    point_lights->update();
+    point_lights->bind(LIGHT_BUFFER_UNIT);
 
-    Framebuffer::unbind();
+    for (unsigned i = 0; i < dynamic_boxes.size(); i++) {
+      float angle = radians(current_frame * 30.0f);
+      dynamic_boxes[i].transform = rotate(dynamic_box_transforms[i], angle, vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    if (clustered) build_clusters();
+
+    // Record shadow tiles and light volumes on the worker threads, then submit everything in order
+    Frustum frustum(camera->get_projection_matrix(aspect_ratio()) * camera->get_view_matrix());
+    allocate_shadows(frustum);
+    record_shadow_passes();
+    record_dynamic_geometry();
+    if (!clustered) record_light_volumes(frustum);
 
-    // Postprocessing
-    post_processing->run();
+    // Render the frame
+    camera->update_matrices(aspect_ratio());
+    gpu_profiler->begin_zone("frame");
+    render_graph.execute();
+    gpu_profiler->end_zone();
+
+    report_timings();
+    update_benchmark();
+    update_shadow_budget();
+    update_render_scale();
   }
 };
 
-int main() {
-  DeferredRenderingWindow window;
+// Usage: deferred-rendering [total lights] [shadowed lights], lights past the shadowed ones are static fill lights
+int main(int argc, char *argv[]) {
+  unsigned total_lights = argc > 1 ? (unsigned) std::stoul(argv[1]) : N_LIGHTS;
+  unsigned shadowed_lights = argc > 2 ? (unsigned) std::stoul(argv[2]) : N_LIGHTS;
+
+  DeferredRenderingWindow window(total_lights, shadowed_lights);
   window.start();
 
   glfwTerminate();
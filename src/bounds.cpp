@@ -0,0 +1,90 @@
+#include <bounds.h>
+
+bool AABB::empty() const {
+  return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+void AABB::expand(vec3 point) {
+  min = glm::min(min, point);
+  max = glm::max(max, point);
+}
+
+void AABB::expand(const AABB &other) {
+  if (other.empty()) return;
+  expand(other.min);
+  expand(other.max);
+}
+
+vec3 AABB::center() const {
+  return (min + max) * 0.5f;
+}
+
+AABB AABB::transformed(const mat4 &transform) const {
+  AABB result;
+  if (empty()) return result;
+
+  for (unsigned i = 0; i < 8; i++) {
+    vec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+    result.expand(vec3(transform * vec4(corner, 1.0f)));
+  }
+  return result;
+}
+
+float AABB::distance_squared(vec3 point) const {
+  vec3 closest = clamp(point, min, max);
+  vec3 d = point - closest;
+  return dot(d, d);
+}
+
+bool AABB::intersects_sphere(vec3 center, float radius) const {
+  return !empty() && distance_squared(center) <= radius * radius;
+}
+
+unsigned AABB::cube_faces(vec3 center, float radius) const {
+  if (!intersects_sphere(center, radius)) return 0;
+
+  // A face sees the points whose coordinate along its axis dominates the other two, so the box is in
+  // view if its furthest reach along the axis beats its smallest extent (in absolute value) along both
+  vec3 lo = min - center, hi = max - center;
+  vec3 closest = vec3(
+    lo.x > 0.0f ? lo.x : hi.x < 0.0f ? -hi.x : 0.0f,
+    lo.y > 0.0f ? lo.y : hi.y < 0.0f ? -hi.y : 0.0f,
+    lo.z > 0.0f ? lo.z : hi.z < 0.0f ? -hi.z : 0.0f
+  );
+
+  unsigned mask = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    float other = glm::max(closest[(axis + 1) % 3], closest[(axis + 2) % 3]);
+    if (hi[axis] >= 0.0f && hi[axis] >= other) mask |= 1u << (axis * 2);
+    if (lo[axis] <= 0.0f && -lo[axis] >= other) mask |= 1u << (axis * 2 + 1);
+  }
+  return mask;
+}
+
+Frustum::Frustum(const mat4 &view_projection) : planes() {
+  // Gribb-Hartmann: each plane is the last row of the matrix plus or minus one of the others
+  mat4 m = transpose(view_projection);
+  for (int i = 0; i < 3; i++) {
+    planes[i * 2] = m[3] + m[i];
+    planes[i * 2 + 1] = m[3] - m[i];
+  }
+  for (auto &plane: planes) plane /= length(vec3(plane));
+}
+
+bool Frustum::intersects_sphere(vec3 center, float radius) const {
+  for (const auto &plane: planes) {
+    if (dot(vec3(plane), center) + plane.w < -radius) return false;
+  }
+  return true;
+}
+
+bool Frustum::intersects(const AABB &box) const {
+  if (box.empty()) return false;
+
+  for (const auto &plane: planes) {
+    vec3 furthest(plane.x > 0.0f ? box.max.x : box.min.x, plane.y > 0.0f ? box.max.y : box.min.y,
+                  plane.z > 0.0f ? box.max.z : box.min.z);
+    if (dot(vec3(plane), furthest) + plane.w < 0.0f) return false;
+  }
+  return true;
+}
@@ -1,4 +1,5 @@
 #include <camera.h>
+#include <render_stats.h>
 
 Camera::Camera(vec3 position, float fov, vec2 angles, unsigned binding_point)
   : position(position), fov(fov), angles(angles), matrix_ubo(0), binding_point(binding_point) {
@@ -16,7 +17,7 @@ mat4 Camera::get_view_matrix() const {
 }
 
 mat4 Camera::get_projection_matrix(float aspect) const {
-  return perspective(radians(fov), aspect, 0.1f, 100.0f);
+  return perspective(radians(fov), aspect, near_plane, far_plane);
 }
 
 void Camera::process_mouse_input(double x_pos, double y_pos) {
@@ -69,6 +70,7 @@ void Camera::update_matrices(float aspect) const {
   mat4 view = get_view_matrix();
   mat4 projection = get_projection_matrix(aspect);
 
+  RenderStats::upload(2 * sizeof(mat4));
   glBindBuffer(GL_UNIFORM_BUFFER, matrix_ubo);
   glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(mat4), value_ptr(view));
   glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4), sizeof(mat4), value_ptr(projection));
@@ -0,0 +1,142 @@
+#include <color_lut.h>
+#include <render_stats.h>
+
+#include <chrono>
+#include <cmath>
+
+namespace {
+vec3 aces(vec3 color) {
+  // sRGB => XYZ => D65_2_D60 => AP1 => RRT_SAT
+  mat3 input = transpose(mat3(
+    0.59719f, 0.35458f, 0.04823f,
+    0.07600f, 0.90834f, 0.01566f,
+    0.02840f, 0.13383f, 0.83777f
+  ));
+  // ODT_SAT => XYZ => D60_2_D65 => sRGB
+  mat3 output = transpose(mat3(
+    1.60475f, -0.53108f, -0.07367f,
+    -0.10208f, 1.10813f, -0.00605f,
+    -0.00327f, -0.07276f, 1.07602f
+  ));
+
+  color = input * color;
+  vec3 a = color * (color + 0.0245786f) - 0.000090537f;
+  vec3 b = color * (0.983729f * color + 0.4329510f) + 0.238081f;
+  return clamp(output * (a / b), 0.0f, 1.0f);
+}
+
+float luma(vec3 color) {
+  return dot(color, vec3(0.2126f, 0.7152f, 0.0722f));
+}
+}
+
+bool ColorGrading::operator==(const ColorGrading &other) const {
+  return curve == other.curve && exposure == other.exposure && white_balance == other.white_balance &&
+         contrast == other.contrast && saturation == other.saturation && lift == other.lift &&
+         gain == other.gain && gamma == other.gamma;
+}
+
+ColorLut::ColorLut(const ColorGrading &grading) : _grading(grading) {
+  glGenTextures(1, &_texture);
+  glBindTexture(GL_TEXTURE_3D, _texture);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, LUT_SIZE, LUT_SIZE, LUT_SIZE, 0, GL_RGB, GL_FLOAT, nullptr);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void ColorLut::set_grading(const ColorGrading &grading) {
+  if (grading == _grading) return;
+  _grading = grading;
+  dirty = true;
+}
+
+const ColorGrading &ColorLut::grading() const {
+  return _grading;
+}
+
+vec3 ColorLut::grade(const ColorGrading &grading, vec3 color) {
+  color *= grading.exposure * grading.white_balance;
+
+  // Contrast scales the distance to middle grey in log space
+  vec3 log_color = log2(max(color, vec3(1e-6f)) / 0.18f) * grading.contrast;
+  color = 0.18f * exp2(log_color);
+  color = max(mix(vec3(luma(color)), color, grading.saturation), vec3(0.0f));
+
+  switch (grading.curve) {
+    case ToneCurve::Reinhard:
+      color = color / (color + vec3(1.0f));
+      break;
+    case ToneCurve::Aces:
+      color = aces(color);
+      break;
+    case ToneCurve::None:
+      break;
+  }
+
+  color = grading.gain * color + grading.lift * (vec3(1.0f) - color);
+  return pow(max(color, vec3(0.0f)), vec3(1.0f / grading.gamma));
+}
+
+std::vector<float> ColorLut::bake(const ColorGrading &grading) {
+  std::vector<float> texels;
+  texels.reserve(LUT_SIZE * LUT_SIZE * LUT_SIZE * 3);
+
+  auto decode = [](int i) {
+    float ev = LUT_MIN_EV + (LUT_MAX_EV - LUT_MIN_EV) * (float) i / (LUT_SIZE - 1);
+    return 0.18f * std::exp2(ev);
+  };
+  for (int b = 0; b < LUT_SIZE; b++) {
+    for (int g = 0; g < LUT_SIZE; g++) {
+      for (int r = 0; r < LUT_SIZE; r++) {
+        vec3 color = grade(grading, vec3(decode(r), decode(g), decode(b)));
+        texels.insert(texels.end(), {color.r, color.g, color.b});
+      }
+    }
+  }
+  return texels;
+}
+
+void ColorLut::add_to(PostProcessing &post_processing) const {
+  post_processing.set_tonemapper("shaders/common/postprocess/pointwise/lut.glsl");
+  post_processing.set_sampler("lutTexture", texture_unit);
+}
+
+void ColorLut::bind() {
+  if (dirty) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<float> texels = bake(_grading);
+    RenderStats::upload(texels.size() * sizeof(float));
+    glBindTexture(GL_TEXTURE_3D, _texture);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, LUT_SIZE, LUT_SIZE, LUT_SIZE, GL_RGB, GL_FLOAT, texels.data());
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    _bake_ms = elapsed.count();
+    _bakes++;
+    dirty = false;
+  }
+
+  RenderStats::current().texture_binds++;
+  glActiveTexture(GL_TEXTURE0 + texture_unit);
+  glBindTexture(GL_TEXTURE_3D, _texture);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+unsigned ColorLut::texture() const {
+  return _texture;
+}
+
+unsigned ColorLut::bakes() const {
+  return _bakes;
+}
+
+double ColorLut::last_bake_ms() const {
+  return _bake_ms;
+}
+
+void ColorLut::free() {
+  glDeleteTextures(1, &_texture);
+}
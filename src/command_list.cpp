@@ -0,0 +1,328 @@
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <type_traits>
+
+#include <command_list.h>
+#include <render_stats.h>
+
+namespace {
+struct ViewportCmd {
+  int x, y, width, height;
+};
+
+struct UniformBlockCmd {
+  const char *name;
+  unsigned binding_point;
+};
+
+struct UniformIntCmd {
+  const char *name;
+  int value;
+};
+
+struct UniformMatrixCmd {
+  const char *name;
+  mat4 value;
+};
+
+struct TextureCmd {
+  unsigned unit;
+  GLenum target;
+  unsigned texture;
+};
+
+struct InstanceRangeCmd {
+  unsigned first, count;
+};
+
+struct CapabilityCmd {
+  GLenum capability;
+  bool enabled;
+};
+
+struct StencilFuncCmd {
+  GLenum func;
+  int ref;
+  unsigned mask;
+};
+
+// Replay-time state, so redundant program and matrix location lookups only happen once per program
+struct ReplayState {
+  const Program *program = nullptr;
+  int model_location = -1, instance_base_location = -1;
+  unsigned instance_count = 1;
+};
+}
+
+template<typename T>
+void CommandList::push(Op op, const T &payload) {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  Header header{op, (uint16_t) sizeof(T)};
+  size_t offset = buffer.size();
+  buffer.resize(offset + sizeof(Header) + sizeof(T));
+  std::memcpy(buffer.data() + offset, &header, sizeof(Header));
+  std::memcpy(buffer.data() + offset + sizeof(Header), &payload, sizeof(T));
+  num_commands++;
+}
+
+void CommandList::clear() {
+  buffer.clear();
+  num_commands = 0;
+}
+
+bool CommandList::empty() const {
+  return num_commands == 0;
+}
+
+size_t CommandList::size() const {
+  return num_commands;
+}
+
+size_t CommandList::size_bytes() const {
+  return buffer.size();
+}
+
+void CommandList::bind_framebuffer(const Framebuffer &framebuffer) {
+  push(Op::BindFramebuffer, framebuffer.id());
+}
+
+void CommandList::bind_default_framebuffer() {
+  push(Op::BindFramebuffer, 0u);
+}
+
+void CommandList::viewport(int x, int y, int width, int height) {
+  push(Op::Viewport, ViewportCmd{x, y, width, height});
+}
+
+void CommandList::scissor(int x, int y, int width, int height) {
+  push(Op::Scissor, ViewportCmd{x, y, width, height});
+}
+
+void CommandList::clear_buffers(GLbitfield mask) {
+  push(Op::Clear, mask);
+}
+
+void CommandList::use_program(const Program &program) {
+  push(Op::UseProgram, &program);
+}
+
+void CommandList::bind_uniform_block(const char *block_name, unsigned binding_point) {
+  push(Op::BindUniformBlock, UniformBlockCmd{block_name, binding_point});
+}
+
+void CommandList::set_uniform(const char *name, int value) {
+  push(Op::SetUniformInt, UniformIntCmd{name, value});
+}
+
+void CommandList::set_uniform(const char *name, const mat4 &value) {
+  push(Op::SetUniformMatrix, UniformMatrixCmd{name, value});
+}
+
+void CommandList::bind_texture(unsigned texture_unit, GLenum target, unsigned texture) {
+  push(Op::BindTexture, TextureCmd{texture_unit, target, texture});
+}
+
+void CommandList::set_cull_face(bool enabled) {
+  push(Op::SetCullFace, enabled);
+}
+
+void CommandList::cull_mode(GLenum mode) {
+  push(Op::CullMode, mode);
+}
+
+void CommandList::set_capability(GLenum capability, bool enabled) {
+  push(Op::Capability, CapabilityCmd{capability, enabled});
+}
+
+void CommandList::color_mask(bool enabled) {
+  push(Op::ColorMask, enabled);
+}
+
+void CommandList::stencil_func(GLenum func, int ref, unsigned mask) {
+  push(Op::StencilFunc, StencilFuncCmd{func, ref, mask});
+}
+
+void CommandList::set_model_matrix(const mat4 &transform) {
+  push(Op::SetModelMatrix, transform);
+}
+
+void CommandList::set_instance_range(unsigned first, unsigned count) {
+  push(Op::SetInstanceRange, InstanceRangeCmd{first, count});
+}
+
+void CommandList::bind_material(const Mesh &mesh) {
+  push(Op::BindMaterial, &mesh);
+}
+
+void CommandList::draw(const Mesh &mesh) {
+  push(Op::Draw, &mesh);
+}
+
+void CommandList::begin_query(GpuQuery &query) {
+  push(Op::BeginQuery, &query);
+}
+
+void CommandList::end_query(GpuQuery &query) {
+  push(Op::EndQuery, &query);
+}
+
+void CommandList::replay() const {
+  ReplayState state;
+  size_t offset = 0;
+
+  while (offset < buffer.size()) {
+    Header header{};
+    std::memcpy(&header, buffer.data() + offset, sizeof(Header));
+    const unsigned char *payload = buffer.data() + offset + sizeof(Header);
+    offset += sizeof(Header) + header.size;
+
+    switch (header.op) {
+      case Op::BindFramebuffer: {
+        unsigned fbo;
+        std::memcpy(&fbo, payload, sizeof(fbo));
+        RenderStats::current().framebuffer_binds++;
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        break;
+      }
+      case Op::Viewport: {
+        ViewportCmd cmd{};
+        std::memcpy(&cmd, payload, sizeof(cmd));
+        glViewport(cmd.x, cmd.y, cmd.width, cmd.height);
+        break;
+      }
+      case Op::Scissor: {
+        ViewportCmd cmd{};
+        std::memcpy(&cmd, payload, sizeof(cmd));
+        glScissor(cmd.x, cmd.y, cmd.width, cmd.height);
+        break;
+      }
+      case Op::Clear: {
+        GLbitfield mask;
+        std::memcpy(&mask, payload, sizeof(mask));
+        RenderStats::current().clears++;
+        glClear(mask);
+        break;
+      }
+      case Op::UseProgram: {
+        const Program *program;
+        std::memcpy(&program, payload, sizeof(program));
+        if (program != state.program) {
+          state.program = program;
+          state.model_location = program->uniform_location("model");
+          state.instance_base_location = program->uniform_location("instanceBase");
+        }
+        program->use();
+        break;
+      }
+      case Op::BindUniformBlock: {
+        UniformBlockCmd cmd{};
+        std::memcpy(&cmd, payload, sizeof(cmd));
+        if (state.program) state.program->bind_uniform_block(cmd.name, cmd.binding_point);
+        break;
+      }
+      case Op::SetUniformInt: {
+        UniformIntCmd cmd{};
+        std::memcpy(&cmd, payload, sizeof(cmd));
+        if (state.program) state.program->set(cmd.name, cmd.value);
+        break;
+      }
+      case Op::SetUniformMatrix: {
+        UniformMatrixCmd cmd{};
+        std::memcpy(&cmd, payload, sizeof(cmd));
+        if (state.program) state.program->set_matrix(cmd.name, cmd.value);
+        break;
+      }
+      case Op::BindTexture: {
+        TextureCmd cmd{};
+        std::memcpy(&cmd, payload, sizeof(cmd));
+        RenderStats::current().texture_binds++;
+        glActiveTexture(GL_TEXTURE0 + cmd.unit);
+        glBindTexture(cmd.target, cmd.texture);
+        break;
+      }
+      case Op::SetCullFace: {
+        bool enabled;
+        std::memcpy(&enabled, payload, sizeof(enabled));
+        if (enabled)
+          glEnable(GL_CULL_FACE);
+        else
+          glDisable(GL_CULL_FACE);
+        break;
+      }
+      case Op::CullMode: {
+        GLenum mode;
+        std::memcpy(&mode, payload, sizeof(mode));
+        glCullFace(mode);
+        break;
+      }
+      case Op::Capability: {
+        CapabilityCmd cmd{};
+        std::memcpy(&cmd, payload, sizeof(cmd));
+        if (cmd.enabled)
+          glEnable(cmd.capability);
+        else
+          glDisable(cmd.capability);
+        break;
+      }
+      case Op::ColorMask: {
+        bool enabled;
+        std::memcpy(&enabled, payload, sizeof(enabled));
+        glColorMask(enabled, enabled, enabled, enabled);
+        break;
+      }
+      case Op::StencilFunc: {
+        StencilFuncCmd cmd{};
+        std::memcpy(&cmd, payload, sizeof(cmd));
+        glStencilFunc(cmd.func, cmd.ref, cmd.mask);
+        break;
+      }
+      case Op::SetModelMatrix: {
+        mat4 transform;
+        std::memcpy(&transform, payload, sizeof(transform));
+        RenderStats::current().uniform_calls++;
+        glUniformMatrix4fv(state.model_location, 1, GL_FALSE, value_ptr(transform));
+        break;
+      }
+      case Op::SetInstanceRange: {
+        InstanceRangeCmd cmd{};
+        std::memcpy(&cmd, payload, sizeof(cmd));
+        state.instance_count = cmd.count;
+        if (state.instance_base_location >= 0) {
+          RenderStats::current().uniform_calls++;
+          glUniform1i(state.instance_base_location, (int) cmd.first);
+        }
+        break;
+      }
+      case Op::BindMaterial: {
+        const Mesh *mesh;
+        std::memcpy(&mesh, payload, sizeof(mesh));
+        if (state.program) mesh->bind_textures(*state.program);
+        break;
+      }
+      case Op::Draw: {
+        const Mesh *mesh;
+        std::memcpy(&mesh, payload, sizeof(mesh));
+        mesh->draw_elements(state.instance_count);
+        break;
+      }
+      case Op::BeginQuery: {
+        GpuQuery *query;
+        std::memcpy(&query, payload, sizeof(query));
+        query->begin();
+        break;
+      }
+      case Op::EndQuery: {
+        GpuQuery *query;
+        std::memcpy(&query, payload, sizeof(query));
+        query->end();
+        break;
+      }
+    }
+  }
+}
+
+void CommandList::replay(const std::vector<CommandList> &lists) {
+  for (const auto &list: lists) list.replay();
+}
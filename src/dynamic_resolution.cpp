@@ -0,0 +1,58 @@
+#include <dynamic_resolution.h>
+
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(
+  double target_ms,
+  float min_scale,
+  float max_scale,
+  float hysteresis,
+  float step,
+  unsigned settle_frames
+) : target_ms(target_ms), min_scale(min_scale), max_scale(max_scale), hysteresis(hysteresis), step(step),
+    _scale(max_scale), settle_frames(settle_frames) {
+}
+
+bool DynamicResolution::update(double gpu_ms) {
+  if (gpu_ms <= 0.0) return false;
+
+  total_ms += gpu_ms;
+  if (++frames < settle_frames) return false;
+
+  double average = total_ms / frames;
+  frames = 0;
+  total_ms = 0.0;
+  if (std::abs(average - target_ms) <= target_ms * hysteresis) return false;
+
+  float ideal = _scale * (float) std::sqrt(target_ms / average);
+  float snapped = std::round(ideal / step) * step;
+
+  // Always move at least one step out of the band, or small errors would never be corrected
+  if (snapped == _scale) snapped += average > target_ms ? -step : step;
+  snapped = std::clamp(snapped, min_scale, max_scale);
+  if (snapped == _scale) return false;
+
+  _scale = snapped;
+  return true;
+}
+
+float DynamicResolution::scale() const {
+  return _scale;
+}
+
+double DynamicResolution::target() const {
+  return target_ms;
+}
+
+void DynamicResolution::set_target(double ms) {
+  target_ms = ms;
+  frames = 0;
+  total_ms = 0.0;
+}
+
+void DynamicResolution::reset() {
+  _scale = max_scale;
+  frames = 0;
+  total_ms = 0.0;
+}
@@ -1,4 +1,5 @@
 #include <framebuffer.h>
+#include <render_stats.h>
 
 Framebuffer::Framebuffer() : _id(0) {
   glGenFramebuffers(1, &_id);
@@ -9,15 +10,21 @@ unsigned Framebuffer::id() const {
 }
 
 void Framebuffer::bind() const {
+  RenderStats::current().framebuffer_binds++;
   glBindFramebuffer(GL_FRAMEBUFFER, _id);
 }
 
 void Framebuffer::unbind() {
+  RenderStats::current().framebuffer_binds++;
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-TextureFramebuffer::TextureFramebuffer(int width, int height, std::vector<GLint> internal_formats)
-  : Framebuffer(), _rbo(0) {
+TextureFramebuffer::TextureFramebuffer(
+  int width,
+  int height,
+  std::vector<GLint> internal_formats,
+  DepthAttachment depth
+) : Framebuffer(), _rbo(0), _depth(0) {
   glBindFramebuffer(GL_FRAMEBUFFER, _id);
 
   size_t num_textures = internal_formats.size();
@@ -38,19 +45,43 @@ TextureFramebuffer::TextureFramebuffer(int width, int height, std::vector<GLint>
     attachments.push_back(attachment);
     glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, textures[i], 0);
   }
-  glDrawBuffers((int) num_textures, attachments.data());
+  if (num_textures > 0) {
+    glDrawBuffers((int) num_textures, attachments.data());
+  } else {
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  }
 
-  glGenRenderbuffers(1, &_rbo);
-  glBindRenderbuffer(GL_RENDERBUFFER, _rbo);
-  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-  glBindRenderbuffer(GL_RENDERBUFFER, 0);
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _rbo);
+  if (depth == DepthAttachment::Texture) {
+    glGenTextures(1, &_depth);
+    glBindTexture(GL_TEXTURE_2D, _depth);
+    glTexImage2D(
+      GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr
+    );
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, _depth, 0);
+  } else if (depth == DepthAttachment::Renderbuffer) {
+    glGenRenderbuffers(1, &_rbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, _rbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _rbo);
+  }
 
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-TextureFramebuffer::TextureFramebuffer(int width, int height, GLint internal_format, unsigned num_textures)
-  : TextureFramebuffer(width, height, std::vector<GLint>(num_textures, internal_format)) {
+TextureFramebuffer::TextureFramebuffer(
+  int width,
+  int height,
+  GLint internal_format,
+  unsigned num_textures,
+  DepthAttachment depth
+) : TextureFramebuffer(width, height, std::vector<GLint>(num_textures, internal_format), depth) {
 }
 
 unsigned TextureFramebuffer::texture(unsigned idx) const {
@@ -59,21 +90,63 @@ unsigned TextureFramebuffer::texture(unsigned idx) const {
 
 void TextureFramebuffer::free() {
   glDeleteTextures((int) textures.size(), textures.data());
-  glDeleteRenderbuffers(1, &_rbo);
+  if (_depth) glDeleteTextures(1, &_depth);
+  if (_rbo) glDeleteRenderbuffers(1, &_rbo);
   glDeleteFramebuffers(1, &_id);
 }
 
 void TextureFramebuffer::bind_texture(unsigned texture_unit, unsigned idx) const {
+  RenderStats::current().texture_binds++;
   glActiveTexture(GL_TEXTURE0 + texture_unit);
   glBindTexture(GL_TEXTURE_2D, textures[idx]);
 }
 
-DepthFramebuffer::DepthFramebuffer(int width, int height) : Framebuffer(), _depth(0) {
+unsigned TextureFramebuffer::depth_texture() const {
+  return _depth;
+}
+
+void TextureFramebuffer::bind_depth_texture(unsigned texture_unit) const {
+  RenderStats::current().texture_binds++;
+  glActiveTexture(GL_TEXTURE0 + texture_unit);
+  glBindTexture(GL_TEXTURE_2D, _depth);
+}
+
+AttachmentFramebuffer::AttachmentFramebuffer(
+  const std::vector<unsigned> &color_textures,
+  unsigned depth_stencil_texture
+) : Framebuffer() {
+  glBindFramebuffer(GL_FRAMEBUFFER, _id);
+
+  std::vector<unsigned> attachments;
+  for (int i = 0; i < color_textures.size(); i++) {
+    unsigned attachment = GL_COLOR_ATTACHMENT0 + i;
+    attachments.push_back(attachment);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, color_textures[i], 0);
+  }
+  if (!attachments.empty()) {
+    glDrawBuffers((int) attachments.size(), attachments.data());
+  } else {
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  }
+
+  if (depth_stencil_texture) {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth_stencil_texture, 0);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void AttachmentFramebuffer::free() {
+  glDeleteFramebuffers(1, &_id);
+}
+
+DepthFramebuffer::DepthFramebuffer(int width, int height, GLint internal_format) : Framebuffer(), _depth(0) {
   glBindFramebuffer(GL_FRAMEBUFFER, _id);
 
   glGenTextures(1, &_depth);
   glBindTexture(GL_TEXTURE_2D, _depth);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+  glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -127,3 +200,42 @@ void DepthCubeFramebuffer::free() {
   glDeleteTextures(1, &_depth);
   glDeleteFramebuffers(1, &_id);
 }
+
+DepthArrayFramebuffer::DepthArrayFramebuffer(int width, int height, int layers, GLint internal_format)
+  : Framebuffer(), _depth(0) {
+  glBindFramebuffer(GL_FRAMEBUFFER, _id);
+
+  glGenTextures(1, &_depth);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, _depth);
+  glTexImage3D(
+    GL_TEXTURE_2D_ARRAY, 0, internal_format, width, height, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr
+  );
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  float border_color[] = {1.0f, 1.0f, 1.0f, 1.0f};
+  glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border_color);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _depth, 0, 0);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+unsigned DepthArrayFramebuffer::depth_map() const {
+  return _depth;
+}
+
+void DepthArrayFramebuffer::bind_layer(int layer) const {
+  RenderStats::current().framebuffer_binds++;
+  glBindFramebuffer(GL_FRAMEBUFFER, _id);
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _depth, 0, layer);
+}
+
+void DepthArrayFramebuffer::free() {
+  glDeleteTextures(1, &_depth);
+  glDeleteFramebuffers(1, &_id);
+}
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include <gaussian_kernel.h>
+
+GaussianKernel::GaussianKernel(float sigma, int radius) : _sigma(sigma), _radius(std::max(radius, 0)) {
+  std::vector<double> discrete(_radius + 1);
+  double total = 0.0;
+  for (int i = 0; i <= _radius; i++) {
+    discrete[i] = std::exp(-(double) (i * i) / (2.0 * sigma * sigma));
+    total += i == 0 ? discrete[i] : 2.0 * discrete[i];
+  }
+  for (auto &weight: discrete) weight /= total;
+
+  _offsets.push_back(0.0f);
+  _weights.push_back((float) discrete[0]);
+  for (int i = 1; i <= _radius; i += 2) {
+    double w1 = discrete[i], w2 = i + 1 <= _radius ? discrete[i + 1] : 0.0;
+    _offsets.push_back((float) ((i * w1 + (i + 1) * w2) / (w1 + w2)));
+    _weights.push_back((float) (w1 + w2));
+  }
+}
+
+GaussianKernel GaussianKernel::from_sigma(float sigma) {
+  return {sigma, (int) std::ceil(3.0f * sigma)};
+}
+
+GaussianKernel GaussianKernel::from_radius(int radius) {
+  return {std::max((float) radius / 3.0f, 0.5f), radius};
+}
+
+float GaussianKernel::sigma() const {
+  return _sigma;
+}
+
+int GaussianKernel::radius() const {
+  return _radius;
+}
+
+const std::vector<float> &GaussianKernel::offsets() const {
+  return _offsets;
+}
+
+const std::vector<float> &GaussianKernel::weights() const {
+  return _weights;
+}
+
+unsigned GaussianKernel::fetches() const {
+  return (unsigned) _offsets.size() * 2 - 1;
+}
+
+std::string GaussianKernel::defines() const {
+  auto array = [](const std::vector<float> &values) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(7) << "float[](";
+    for (size_t i = 0; i < values.size(); i++) ss << (i ? ", " : "") << values[i];
+    ss << ")";
+    return ss.str();
+  };
+
+  std::ostringstream ss;
+  ss << "#define KERNEL_TAPS " << _offsets.size() << "\n"
+     << "const float KERNEL_OFFSETS[KERNEL_TAPS] = " << array(_offsets) << ";\n"
+     << "const float KERNEL_WEIGHTS[KERNEL_TAPS] = " << array(_weights) << ";\n";
+  return ss.str();
+}
@@ -0,0 +1,28 @@
+#include <gl_compute.h>
+
+#include <GLFW/glfw3.h>
+
+#ifndef GL_VERSION_4_3
+PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute = nullptr;
+PFNGLBINDIMAGETEXTUREPROC glad_glBindImageTexture = nullptr;
+PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier = nullptr;
+#endif
+
+bool load_compute_functions() {
+  static int supported = -1;
+  if (supported >= 0) return supported;
+
+  int major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  supported = major > 4 || (major == 4 && minor >= 3);
+  if (!supported) return false;
+
+#ifndef GL_VERSION_4_3
+  glad_glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC) glfwGetProcAddress("glDispatchCompute");
+  glad_glBindImageTexture = (PFNGLBINDIMAGETEXTUREPROC) glfwGetProcAddress("glBindImageTexture");
+  glad_glMemoryBarrier = (PFNGLMEMORYBARRIERPROC) glfwGetProcAddress("glMemoryBarrier");
+  supported = glad_glDispatchCompute && glad_glBindImageTexture && glad_glMemoryBarrier;
+#endif
+  return supported;
+}
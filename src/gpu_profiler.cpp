@@ -0,0 +1,197 @@
+#include <gpu_profiler.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <iomanip>
+
+ZoneStats::ZoneStats(std::string name, size_t window)
+  : _name(std::move(name)), window(std::max(window, (size_t) 1)) {
+}
+
+void ZoneStats::add(double ms, uint64_t frame) {
+  // Frames collected together come in ring order, not necessarily oldest first
+  if (frame >= _last_frame) {
+    last = ms;
+    _last_frame = frame;
+  }
+  if (samples.size() < window) {
+    samples.push_back(ms);
+  } else {
+    samples[next] = ms;
+  }
+  next = (next + 1) % window;
+}
+
+const std::string &ZoneStats::name() const {
+  return _name;
+}
+
+size_t ZoneStats::count() const {
+  return samples.size();
+}
+
+double ZoneStats::last_ms() const {
+  return last;
+}
+
+uint64_t ZoneStats::last_frame() const {
+  return _last_frame;
+}
+
+double ZoneStats::average_ms() const {
+  if (samples.empty()) return 0.0;
+  double total = 0.0;
+  for (double sample: samples) total += sample;
+  return total / (double) samples.size();
+}
+
+double ZoneStats::min_ms() const {
+  return samples.empty() ? 0.0 : *std::min_element(samples.begin(), samples.end());
+}
+
+double ZoneStats::max_ms() const {
+  return samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end());
+}
+
+double ZoneStats::percentile_ms(double p) const {
+  if (samples.empty()) return 0.0;
+  std::vector<double> sorted = samples;
+  auto rank = (size_t) (std::clamp(p, 0.0, 1.0) * (double) (sorted.size() - 1) + 0.5);
+  std::nth_element(sorted.begin(), sorted.begin() + (long) rank, sorted.end());
+  return sorted[rank];
+}
+
+void ZoneStats::clear() {
+  samples.clear();
+  next = 0;
+  last = 0.0;
+  _last_frame = 0;
+}
+
+GpuProfiler::GpuProfiler(unsigned latency, size_t window) : frames(latency > 0 ? latency : 1), window(window) {
+}
+
+size_t GpuProfiler::zone_index(const std::string &name) {
+  for (size_t i = 0; i < _zones.size(); i++) {
+    if (_zones[i].name() == name) return i;
+  }
+  _zones.emplace_back(name, window);
+  return _zones.size() - 1;
+}
+
+unsigned GpuProfiler::timestamp(Frame &frame) {
+  if (frame.used == frame.queries.size()) {
+    unsigned query;
+    glGenQueries(1, &query);
+    frame.queries.push_back(query);
+  }
+  glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+  return frame.used++;
+}
+
+// Timestamps complete in order, the frame's last one being available means all of them are
+void GpuProfiler::collect(Frame &frame) {
+  if (!frame.in_flight) return;
+
+  int available = 0;
+  glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) return;
+
+  std::vector<GLuint64> times(frame.used);
+  for (size_t i = 0; i < frame.used; i++) glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &times[i]);
+  for (const auto &zone: frame.zones) {
+    // Frames from before clear() still go to a trace, just not into the stats
+    if (frame.number > cleared_frame) {
+      _zones[zone.stats].add((double) (times[zone.end] - times[zone.start]) / 1e6, frame.number);
+    }
+    Trace::gpu_event(_zones[zone.stats].name(), frame.trace_frame, times[zone.start], times[zone.end]);
+  }
+  frame.in_flight = false;
+}
+
+void GpuProfiler::begin_frame() {
+  for (auto &frame: frames) collect(frame);
+
+  frame_number++;
+  slot = (slot + 1) % frames.size();
+  Frame &frame = frames[slot];
+  measuring = !frame.in_flight;
+  if (!measuring) return;
+
+  frame.number = frame_number;
+  frame.trace_frame = Trace::frame_index();
+  frame.zones.clear();
+  frame.used = 0;
+  open.clear();
+}
+
+void GpuProfiler::end_frame() {
+  if (!measuring) return;
+  if (!open.empty()) std::cerr << "ERROR::GPU_PROFILER::UNCLOSED_ZONE::" << _zones[open.back()].name() << "\n";
+
+  Frame &frame = frames[slot];
+  frame.in_flight = frame.used > 0 && open.empty();
+  measuring = false;
+}
+
+void GpuProfiler::begin_zone(const std::string &name) {
+  if (!measuring) return;
+
+  Frame &frame = frames[slot];
+  frame.zones.push_back({zone_index(name), timestamp(frame), 0});
+  open.push_back(frame.zones.size() - 1);
+}
+
+void GpuProfiler::end_zone() {
+  if (!measuring || open.empty()) return;
+
+  Frame &frame = frames[slot];
+  frame.zones[open.back()].end = timestamp(frame);
+  open.pop_back();
+}
+
+uint64_t GpuProfiler::frame() const {
+  return frame_number;
+}
+
+const std::vector<ZoneStats> &GpuProfiler::zones() const {
+  return _zones;
+}
+
+const ZoneStats *GpuProfiler::zone(const std::string &name) const {
+  for (const auto &stats: _zones) {
+    if (stats.name() == name) return &stats;
+  }
+  return nullptr;
+}
+
+void GpuProfiler::clear() {
+  for (auto &stats: _zones) stats.clear();
+  cleared_frame = frame_number;
+}
+
+void GpuProfiler::report(std::ostream &out) const {
+  auto precision = out.precision();
+  out << "GPU zones (ms, last " << window << " frames):\n" << std::fixed << std::setprecision(3);
+  for (const auto &stats: _zones) {
+    out << "  " << std::left << std::setw(12) << stats.name() << std::right
+        << " avg " << stats.average_ms() << " | min " << stats.min_ms() << " | max " << stats.max_ms()
+        << " | p95 " << stats.percentile_ms(0.95) << "\n";
+  }
+  out << std::defaultfloat << std::setprecision((int) precision);
+}
+
+void GpuProfiler::free() {
+  for (auto &frame: frames) {
+    if (!frame.queries.empty()) glDeleteQueries((int) frame.queries.size(), frame.queries.data());
+    frame.queries.clear();
+  }
+}
+
+GpuZone::GpuZone(GpuProfiler &profiler, const std::string &name) : profiler(profiler) {
+  profiler.begin_zone(name);
+}
+
+GpuZone::~GpuZone() {
+  profiler.end_zone();
+}
@@ -0,0 +1,72 @@
+#include <gpu_timer.h>
+
+GpuQuery::GpuQuery(GLenum target, unsigned latency)
+  : target(target), queries(latency > 0 ? latency : 1), in_flight(queries.size(), false) {
+  glGenQueries((int) queries.size(), queries.data());
+}
+
+void GpuQuery::collect(unsigned idx) {
+  if (!in_flight[idx]) return;
+
+  int available = 0;
+  glGetQueryObjectiv(queries[idx], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) return;
+
+  GLuint64 value = 0;
+  glGetQueryObjectui64v(queries[idx], GL_QUERY_RESULT, &value);
+  in_flight[idx] = false;
+
+  on_result(value);
+}
+
+void GpuQuery::begin() {
+  for (unsigned i = 0; i < queries.size(); i++) collect(i);
+
+  slot = (slot + 1) % queries.size();
+  measuring = !in_flight[slot];
+  if (measuring) glBeginQuery(target, queries[slot]);
+}
+
+void GpuQuery::end() {
+  if (!measuring) return;
+
+  glEndQuery(target);
+  in_flight[slot] = true;
+  measuring = false;
+}
+
+void GpuQuery::free() {
+  glDeleteQueries((int) queries.size(), queries.data());
+}
+
+GpuTimer::GpuTimer(unsigned latency) : GpuQuery(GL_TIME_ELAPSED, latency) {
+}
+
+void GpuTimer::on_result(GLuint64 value) {
+  last = (double) value / 1e6;
+  average = samples++ == 0 ? last : average * 0.9 + last * 0.1;
+}
+
+double GpuTimer::last_ms() const {
+  return last;
+}
+
+double GpuTimer::average_ms() const {
+  return average;
+}
+
+GpuCounter::GpuCounter(GLenum target, unsigned latency) : GpuQuery(target, latency) {
+}
+
+void GpuCounter::on_result(GLuint64 value) {
+  last = value;
+  average = samples++ == 0 ? (double) value : average * 0.9 + (double) value * 0.1;
+}
+
+GLuint64 GpuCounter::last_count() const {
+  return last;
+}
+
+double GpuCounter::average_count() const {
+  return average;
+}
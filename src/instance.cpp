@@ -1,14 +1,39 @@
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+
 #include <instance.h>
+#include <render_stats.h>
 
 Instance::Instance(const Model &obj, const Program &program)
   : obj(obj), program(program) {
 }
 
+AABB Instance::bounds() const {
+  return obj.bounds().transformed(transform);
+}
+
+void Instance::assign_lights(const std::vector<vec4> &light_spheres, unsigned max_lights) {
+  AABB box = bounds();
+
+  std::vector<std::pair<float, unsigned>> overlapping;
+  for (unsigned i = 0; i < light_spheres.size(); i++) {
+    float radius = light_spheres[i].w;
+    float d2 = box.distance_squared(vec3(light_spheres[i]));
+    if (d2 <= radius * radius) overlapping.emplace_back(d2, i);
+  }
+
+  size_t count = std::min<size_t>(overlapping.size(), max_lights);
+  std::partial_sort(overlapping.begin(), overlapping.begin() + (long) count, overlapping.end());
+
+  lights.clear();
+  for (size_t i = 0; i < count; i++) lights.push_back(overlapping[i].second);
+}
+
 void Instance::draw(const char *model_matrix_name) const {
   program.use();
   int loc_model = program.uniform_location(model_matrix_name);
+  RenderStats::current().uniform_calls++;
   glUniformMatrix4fv(loc_model, 1, GL_FALSE, value_ptr(transform));
   obj.draw(program);
 }
@@ -16,6 +41,25 @@ void Instance::draw(const char *model_matrix_name) const {
 void Instance::draw_with(const Program &prog, const char *model_matrix_name) const {
   prog.use();
   int loc_model = prog.uniform_location(model_matrix_name);
+  RenderStats::current().uniform_calls++;
   glUniformMatrix4fv(loc_model, 1, GL_FALSE, value_ptr(transform));
   obj.draw(prog);
 }
+
+void Instance::draw_instanced_with(const Program &prog, unsigned count, const char *model_matrix_name) const {
+  prog.use();
+  int loc_model = prog.uniform_location(model_matrix_name);
+  RenderStats::current().uniform_calls++;
+  glUniformMatrix4fv(loc_model, 1, GL_FALSE, value_ptr(transform));
+  obj.draw_instanced(prog, count);
+}
+
+void Instance::record(CommandList &list) const {
+  record_with(list, program);
+}
+
+void Instance::record_with(CommandList &list, const Program &prog) const {
+  list.use_program(prog);
+  list.set_model_matrix(transform);
+  obj.record(list);
+}
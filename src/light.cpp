@@ -1,4 +1,8 @@
+#include <cmath>
+
 #include <light.h>
+#include <render_stats.h>
+#include <trace.h>
 
 Light::Light(unsigned binding_point, unsigned ubo_size, vec3 ambient, vec3 diffuse, vec3 specular)
   : ambient(ambient), diffuse(diffuse), specular(specular), ubo(0), binding_point(binding_point) {
@@ -11,66 +15,188 @@ Light::Light(unsigned binding_point, unsigned ubo_size, vec3 ambient, vec3 diffu
   glBindBufferBase(GL_UNIFORM_BUFFER, binding_point, ubo);
 }
 
+Light::Light(vec3 ambient, vec3 diffuse, vec3 specular)
+  : ambient(ambient), diffuse(diffuse), specular(specular), ubo(0) {
+}
+
 void Light::set_ubo_binding(const Program &program, const char *block_name) const {
   program.bind_uniform_block(block_name, binding_point);
 }
 
+void DirectionalLight::fit_cascades(
+  const Camera &camera,
+  float aspect,
+  unsigned count,
+  int resolution,
+  float max_distance,
+  float lambda
+) {
+  cascade_count = clamp(count, 1u, (unsigned) MAX_CASCADES);
+  float near = camera.near_plane, far = min(camera.far_plane, max_distance);
+
+  vec3 forward = normalize(camera.forward);
+  vec3 right = normalize(cross(forward, camera.up));
+  vec3 up = cross(right, forward);
+  float tan_y = tan(radians(camera.fov) * 0.5f), tan_x = tan_y * aspect;
+
+  vec3 light_dir = normalize(direction);
+  vec3 light_up = abs(light_dir.y) > 0.99f ? vec3(0.0f, 0.0f, 1.0f) : vec3(0.0f, 1.0f, 0.0f);
+  mat4 light_rotation = lookAt(vec3(0.0f), light_dir, light_up);
+
+  float slice_near = near;
+  for (unsigned i = 0; i < cascade_count; i++) {
+    // Practical split scheme: blend of logarithmic and uniform splits
+    float t = (float) (i + 1) / (float) cascade_count;
+    float slice_far = lambda * near * pow(far / near, t) + (1.0f - lambda) * (near + (far - near) * t);
+    cascade_splits[i] = slice_far;
+
+    vec3 corners[8];
+    vec3 center(0.0f);
+    for (unsigned c = 0; c < 8; c++) {
+      float d = (c & 4) ? slice_far : slice_near;
+      vec3 x = right * d * tan_x * ((c & 1) ? 1.0f : -1.0f), y = up * d * tan_y * ((c & 2) ? 1.0f : -1.0f);
+      corners[c] = camera.position + forward * d + x + y;
+      center += corners[c] / 8.0f;
+    }
+
+    // Bounding sphere radius, rounded up so float noise doesn't change the texel size between frames
+    float radius = 0.0f;
+    for (const auto &corner: corners) radius = max(radius, length(corner - center));
+    radius = ceil(radius * 16.0f) / 16.0f;
+
+    // Snap the center to the texel grid, in light space
+    float texels_per_unit = (float) resolution / (2.0f * radius);
+    vec3 light_center = vec3(light_rotation * vec4(center, 1.0f));
+    light_center.x = floor(light_center.x * texels_per_unit) / texels_per_unit;
+    light_center.y = floor(light_center.y * texels_per_unit) / texels_per_unit;
+    center = vec3(inverse(light_rotation) * vec4(light_center, 1.0f));
+
+    mat4 view = lookAt(center - light_dir * radius, center, light_up);
+    mat4 projection = ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius);
+    cascade_matrices[i] = projection * view;
+
+    slice_near = slice_far;
+  }
+}
+
+unsigned DirectionalLight::cascades() const {
+  return cascade_count;
+}
+
+const mat4 &DirectionalLight::cascade_matrix(unsigned cascade) const {
+  return cascade_matrices[cascade];
+}
+
+bool DirectionalLight::cascade_sees(unsigned cascade, const AABB &bounds) const {
+  AABB clip = bounds.transformed(cascade_matrices[cascade]);
+  return !clip.empty() && clip.min.x <= 1.0f && clip.max.x >= -1.0f && clip.min.y <= 1.0f && clip.max.y >= -1.0f &&
+         clip.min.z <= 1.0f;
+}
+
 void DirectionalLight::update_ubo() const {
+  TRACE_ZONE("Light::update_ubo");
+  if (!ubo) return;
+
   float depth = 10.0f;
   mat4 view = lookAt(direction * -depth * 0.5f, vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
   mat4 projection = ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, depth);
-  mat4 light_matrix = projection * view;
+
+  DirectionalLightData data{
+    vec4(direction, 0.0f),
+    vec4(ambient, 0.0f),
+    vec4(diffuse, 0.0f),
+    vec4(specular, 0.0f),
+    cascade_count ? cascade_matrices[0] : projection * view
+  };
+
+  for (unsigned i = 0; i < cascade_count; i++) {
+    data.cascade_matrices[i] = cascade_matrices[i];
+    data.cascade_splits[(int) i] = cascade_splits[i];
+  }
+  data.cascade_count = (int) cascade_count;
 
   glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-  glBufferSubData(GL_UNIFORM_BUFFER, 0 * sizeof(vec4), sizeof(vec4), value_ptr(direction));
-  glBufferSubData(GL_UNIFORM_BUFFER, 1 * sizeof(vec4), sizeof(vec4), value_ptr(ambient));
-  glBufferSubData(GL_UNIFORM_BUFFER, 2 * sizeof(vec4), sizeof(vec4), value_ptr(diffuse));
-  glBufferSubData(GL_UNIFORM_BUFFER, 3 * sizeof(vec4), sizeof(vec4), value_ptr(specular));
-  glBufferSubData(GL_UNIFORM_BUFFER, 4 * sizeof(vec4), sizeof(mat4), value_ptr(light_matrix));
+  RenderStats::upload(sizeof(DirectionalLightData));
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(DirectionalLightData), &data);
   glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
-void PointLight::update_ubo() const {
-  float depth = POINT_SHADOW_FAR;
+float PointLight::radius(float threshold) const {
+  float i_max = max(diffuse.x, max(diffuse.y, diffuse.z));
+  float a = attenuation.z, b = attenuation.y, c = attenuation.x - i_max / threshold;
+  float distance = MAX_LIGHT_RADIUS;
+  if (a != 0.0f) {
+    distance = (-b + sqrt(b * b - 4 * a * c)) / (2 * a);
+  } else if (b > 0.0f) {
+    distance = -c / b;
+  }
+  return clamp(distance, MIN_LIGHT_RADIUS, MAX_LIGHT_RADIUS);
+}
+
+const mat4 *PointLight::shadow_matrices() const {
+  float depth = radius();
+  if (matrices_valid && matrices_position == position && matrices_far == depth) return light_matrices;
+
   float aspect = (float) SHADOW_WIDTH / SHADOW_HEIGHT;
   mat4 projection = perspective(radians(90.0f), aspect, 0.1f, depth);
-  mat4 light_matrices[6] = {
-    projection * lookAt(position, position + vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, -1.0f, 0.0f)),
-    projection * lookAt(position, position + vec3(-1.0f, 0.0f, 0.0f), vec3(0.0f, -1.0f, 0.0f)),
-    projection * lookAt(position, position + vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f)),
-    projection * lookAt(position, position + vec3(0.0f, -1.0f, 0.0f), vec3(0.0f, 0.0f, -1.0f)),
-    projection * lookAt(position, position + vec3(0.0f, 0.0f, 1.0f), vec3(0.0f, -1.0f, 0.0f)),
-    projection * lookAt(position, position + vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, -1.0f, 0.0f))
-  };
+  light_matrices[0] = projection * lookAt(position, position + vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, -1.0f, 0.0f));
+  light_matrices[1] = projection * lookAt(position, position + vec3(-1.0f, 0.0f, 0.0f), vec3(0.0f, -1.0f, 0.0f));
+  light_matrices[2] = projection * lookAt(position, position + vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f));
+  light_matrices[3] = projection * lookAt(position, position + vec3(0.0f, -1.0f, 0.0f), vec3(0.0f, 0.0f, -1.0f));
+  light_matrices[4] = projection * lookAt(position, position + vec3(0.0f, 0.0f, 1.0f), vec3(0.0f, -1.0f, 0.0f));
+  light_matrices[5] = projection * lookAt(position, position + vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, -1.0f, 0.0f));
+
+  matrices_position = position;
+  matrices_far = depth;
+  matrices_valid = true;
+  return light_matrices;
+}
+
+void PointLight::pack(PointLightData &data) const {
+  data.position = vec4(position, radius());
+  data.ambient = vec4(ambient, 0.0f);
+  data.diffuse = vec4(diffuse, 0.0f);
+  data.specular = vec4(specular, 0.0f);
+  data.attenuation = vec4(attenuation, 0.0f);
+
+  const mat4 *matrices = shadow_matrices();
+  for (unsigned i = 0; i < 6; i++) data.light_matrices[i] = matrices[i];
+}
+
+void PointLight::update_ubo() const {
+  TRACE_ZONE("Light::update_ubo");
+  if (!ubo) return;
+
+  PointLightData data{};
+  pack(data);
 
-  constexpr size_t v4s = sizeof(vec4), v3s = sizeof(vec3), ms = sizeof(mat4);
   glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-  glBufferSubData(GL_UNIFORM_BUFFER, 0 * v4s, v3s, value_ptr(position));
-  glBufferSubData(GL_UNIFORM_BUFFER, 1 * v4s, v3s, value_ptr(ambient));
-  glBufferSubData(GL_UNIFORM_BUFFER, 2 * v4s, v3s, value_ptr(diffuse));
-  glBufferSubData(GL_UNIFORM_BUFFER, 3 * v4s, v3s, value_ptr(specular));
-  glBufferSubData(GL_UNIFORM_BUFFER, 4 * v4s, v3s, value_ptr(attenuation));
-  for (unsigned i = 0; i < 6; i++) {
-    glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr) (5 * v4s + i * ms), ms, value_ptr(light_matrices[i]));
-  }
+  RenderStats::upload(sizeof(PointLightData));
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(PointLightData), &data);
   glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void SpotLight::update_ubo() const {
+  TRACE_ZONE("Light::update_ubo");
+  if (!ubo) return;
+
   float depth = 10.0f;
   mat4 view = lookAt(position, position + direction, vec3(0.0f, 1.0f, 0.0f));
   mat4 projection = perspective(acos(cos_outer_angle), 1.0f, 1.0f, depth);
-  mat4 light_matrix = projection * view;
 
-  vec2 angles(cos_outer_angle, cos_inner_angle);
+  SpotLightData data{
+    projection * view,
+    vec4(position, 0.0f),
+    vec4(direction, 0.0f),
+    vec4(ambient, 0.0f),
+    vec4(diffuse, 0.0f),
+    vec4(specular, 0.0f),
+    vec4(attenuation, 0.0f),
+    vec2(cos_outer_angle, cos_inner_angle)
+  };
+
   glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(mat4), value_ptr(light_matrix));
-  glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4) + 0 * sizeof(vec4), sizeof(vec3), value_ptr(position));
-  glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4) + 1 * sizeof(vec4), sizeof(vec3), value_ptr(direction));
-  glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4) + 2 * sizeof(vec4), sizeof(vec3), value_ptr(ambient));
-  glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4) + 3 * sizeof(vec4), sizeof(vec3), value_ptr(diffuse));
-  glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4) + 4 * sizeof(vec4), sizeof(vec3), value_ptr(specular));
-  glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4) + 5 * sizeof(vec4), sizeof(vec3), value_ptr(attenuation));
-  glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4) + 6 * sizeof(vec4), sizeof(vec2), value_ptr(angles));
+  RenderStats::upload(sizeof(SpotLightData));
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SpotLightData), &data);
   glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
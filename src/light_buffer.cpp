@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cstring>
+
+#include <light_buffer.h>
+#include <render_stats.h>
+
+PointLightBuffer::PointLightBuffer(size_t initial_capacity) : tbo(0), texture(0), capacity(0) {
+  glGenBuffers(1, &tbo);
+  glGenTextures(1, &texture);
+  allocate(initial_capacity > 0 ? initial_capacity : 1);
+}
+
+void PointLightBuffer::allocate(size_t new_capacity) {
+  capacity = new_capacity;
+
+  glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+  glBufferData(GL_TEXTURE_BUFFER, (long) (capacity * sizeof(PointLightData)), nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  glBindTexture(GL_TEXTURE_BUFFER, texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, tbo);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+  // The old contents are gone, make sure everything is uploaded again
+  packed.clear();
+}
+
+unsigned PointLightBuffer::add(const PointLight &light) {
+  lights.push_back(light);
+  return (unsigned) lights.size() - 1;
+}
+
+PointLight &PointLightBuffer::operator[](unsigned idx) {
+  return lights[idx];
+}
+
+const PointLight &PointLightBuffer::operator[](unsigned idx) const {
+  return lights[idx];
+}
+
+size_t PointLightBuffer::size() const {
+  return lights.size();
+}
+
+void PointLightBuffer::update() {
+  uploaded_bytes = 0;
+  if (lights.size() > capacity) {
+    size_t new_capacity = capacity;
+    while (new_capacity < lights.size()) new_capacity *= 2;
+    allocate(new_capacity);
+  }
+
+  // Lights added since the last update (or since a reallocation) are always dirty
+  size_t known = packed.size();
+  packed.resize(lights.size());
+
+  size_t first_dirty = lights.size(), last_dirty = 0;
+  for (size_t i = 0; i < lights.size(); i++) {
+    PointLightData data{};
+    lights[i].pack(data);
+
+    if (i >= known || std::memcmp(&data, &packed[i], sizeof(PointLightData)) != 0) {
+      packed[i] = data;
+      first_dirty = std::min(first_dirty, i);
+      last_dirty = i + 1;
+    }
+  }
+
+  if (first_dirty >= last_dirty) return;
+
+  uploaded_bytes = (last_dirty - first_dirty) * sizeof(PointLightData);
+  RenderStats::upload(uploaded_bytes);
+  glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+  glBufferSubData(
+    GL_TEXTURE_BUFFER,
+    (GLintptr) (first_dirty * sizeof(PointLightData)),
+    (GLsizeiptr) uploaded_bytes,
+    packed.data() + first_dirty
+  );
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void PointLightBuffer::bind(unsigned texture_unit) const {
+  RenderStats::current().texture_binds++;
+  glActiveTexture(GL_TEXTURE0 + texture_unit);
+  glBindTexture(GL_TEXTURE_BUFFER, texture);
+}
+
+size_t PointLightBuffer::last_upload_bytes() const {
+  return uploaded_bytes;
+}
+
+void PointLightBuffer::free() {
+  glDeleteTextures(1, &texture);
+  glDeleteBuffers(1, &tbo);
+}
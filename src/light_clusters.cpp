@@ -0,0 +1,135 @@
+#include <light_clusters.h>
+#include <render_stats.h>
+
+namespace {
+constexpr unsigned num_clusters = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+
+unsigned cluster_index(unsigned x, unsigned y, unsigned z) {
+  return (z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x;
+}
+
+// Conservative NDC extent of [lo, hi] (view space, along one axis) for depths in [z_near, z_far]
+vec2 project_range(float lo, float hi, float z_near, float z_far, float scale) {
+  float a = min(lo / z_near, lo / z_far), b = max(hi / z_near, hi / z_far);
+  return vec2(a, b) * scale;
+}
+
+void tile_range(vec2 ndc, unsigned tiles, unsigned &first, unsigned &last) {
+  int a = (int) floor((ndc.x * 0.5f + 0.5f) * (float) tiles);
+  int b = (int) floor((ndc.y * 0.5f + 0.5f) * (float) tiles);
+  first = (unsigned) clamp(a, 0, (int) tiles - 1);
+  last = (unsigned) clamp(b, 0, (int) tiles - 1);
+}
+
+void create_buffer_texture(unsigned &tbo, unsigned &texture, GLenum internal_format) {
+  glGenBuffers(1, &tbo);
+  glGenTextures(1, &texture);
+
+  glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+  glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  glBindTexture(GL_TEXTURE_BUFFER, texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, internal_format, tbo);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+}
+
+LightClusters::LightClusters()
+  : grid_tbo(0), grid_texture(0), index_tbo(0), index_texture(0), cluster_lights(num_clusters), grid(num_clusters) {
+  create_buffer_texture(grid_tbo, grid_texture, GL_RG32UI);
+  create_buffer_texture(index_tbo, index_texture, GL_R32UI);
+}
+
+void LightClusters::build(
+  const std::vector<vec4> &lights,
+  const mat4 &view,
+  const mat4 &projection,
+  float near,
+  float far,
+  ThreadPool &pool
+) {
+  near_plane = near;
+  far_plane = far;
+
+  // View space light positions, depth stored as a positive distance
+  view_lights.resize(lights.size());
+  pool.parallel_for(lights.size(), [&](size_t begin, size_t end, unsigned) {
+    for (size_t i = begin; i < end; i++) {
+      vec4 p = view * vec4(vec3(lights[i]), 1.0f);
+      view_lights[i] = vec4(p.x, p.y, -p.z, lights[i].w);
+    }
+  });
+
+  // Assign lights to clusters, one range of depth slices per worker
+  float scale_x = projection[0][0], scale_y = projection[1][1];
+  float slice_ratio = far_plane / near_plane;
+  pool.parallel_for(CLUSTER_GRID_Z, [&](size_t begin, size_t end, unsigned) {
+    for (auto z = (unsigned) begin; z < end; z++) {
+      float slice_near = near_plane * pow(slice_ratio, (float) z / CLUSTER_GRID_Z);
+      float slice_far = near_plane * pow(slice_ratio, (float) (z + 1) / CLUSTER_GRID_Z);
+
+      for (unsigned y = 0; y < CLUSTER_GRID_Y; y++)
+        for (unsigned x = 0; x < CLUSTER_GRID_X; x++)
+          cluster_lights[cluster_index(x, y, z)].clear();
+
+      for (unsigned i = 0; i < view_lights.size(); i++) {
+        const vec4 &light = view_lights[i];
+        float z_near = max(light.z - light.w, slice_near), z_far = min(light.z + light.w, slice_far);
+        if (z_near > z_far) continue;
+
+        vec2 ndc_x = project_range(light.x - light.w, light.x + light.w, z_near, z_far, scale_x);
+        vec2 ndc_y = project_range(light.y - light.w, light.y + light.w, z_near, z_far, scale_y);
+        if (ndc_x.y < -1.0f || ndc_x.x > 1.0f || ndc_y.y < -1.0f || ndc_y.x > 1.0f) continue;
+
+        unsigned x0, x1, y0, y1;
+        tile_range(ndc_x, CLUSTER_GRID_X, x0, x1);
+        tile_range(ndc_y, CLUSTER_GRID_Y, y0, y1);
+        for (unsigned y = y0; y <= y1; y++)
+          for (unsigned x = x0; x <= x1; x++)
+            cluster_lights[cluster_index(x, y, z)].push_back(i);
+      }
+    }
+  });
+
+  // Flatten into the grid and index list
+  indices.clear();
+  for (unsigned c = 0; c < num_clusters; c++) {
+    grid[c] = uvec2((unsigned) indices.size(), (unsigned) cluster_lights[c].size());
+    indices.insert(indices.end(), cluster_lights[c].begin(), cluster_lights[c].end());
+  }
+  if (indices.empty()) indices.push_back(0);
+
+  RenderStats::upload(grid.size() * sizeof(uvec2) + indices.size() * sizeof(unsigned));
+  glBindBuffer(GL_TEXTURE_BUFFER, grid_tbo);
+  glBufferData(GL_TEXTURE_BUFFER, (long) (grid.size() * sizeof(uvec2)), grid.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, index_tbo);
+  glBufferData(GL_TEXTURE_BUFFER, (long) (indices.size() * sizeof(unsigned)), indices.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::bind(unsigned grid_unit, unsigned index_unit) const {
+  RenderStats::current().texture_binds += 2;
+  glActiveTexture(GL_TEXTURE0 + grid_unit);
+  glBindTexture(GL_TEXTURE_BUFFER, grid_texture);
+  glActiveTexture(GL_TEXTURE0 + index_unit);
+  glBindTexture(GL_TEXTURE_BUFFER, index_texture);
+}
+
+void LightClusters::set_uniforms(const Program &program, int screen_width, int screen_height) const {
+  program.set("clusterGrid", vec3(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z));
+  program.set("screenSize", vec2((float) screen_width, (float) screen_height));
+  program.set("clusterNear", near_plane);
+  program.set("clusterLogRatio", log(far_plane / near_plane));
+}
+
+size_t LightClusters::light_index_count() const {
+  return indices.size();
+}
+
+void LightClusters::free() {
+  glDeleteTextures(1, &grid_texture);
+  glDeleteTextures(1, &index_texture);
+  glDeleteBuffers(1, &grid_tbo);
+  glDeleteBuffers(1, &index_tbo);
+}
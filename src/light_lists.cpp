@@ -0,0 +1,27 @@
+#include <light_lists.h>
+
+LightListPrograms::LightListPrograms(
+  const Shader &vertex_shader,
+  const char *fragment_path,
+  const std::string &defines
+) {
+  for (unsigned i = 0; i < LIGHT_LIST_PERMUTATIONS; i++) {
+    std::string permutation = "#define MAX_LIGHTS " + std::to_string(max_lights(i)) + "\n" + defines;
+    programs[i] = Program(vertex_shader, Shader::fragment(fragment_path, permutation));
+  }
+}
+
+unsigned LightListPrograms::max_lights(unsigned permutation) {
+  return 1u << permutation;
+}
+
+const Program &LightListPrograms::select(size_t light_count) const {
+  for (unsigned i = 0; i < LIGHT_LIST_PERMUTATIONS; i++) {
+    if (light_count <= max_lights(i)) return programs[i];
+  }
+  return programs[LIGHT_LIST_PERMUTATIONS - 1];
+}
+
+Program &LightListPrograms::operator[](unsigned permutation) {
+  return programs[permutation];
+}
@@ -1,4 +1,5 @@
 #include <mesh.h>
+#include <render_stats.h>
 #include <map>
 
 using namespace glm;
@@ -79,6 +80,57 @@ void Mesh::init(unsigned pos_location, unsigned normal_location, unsigned uv_loc
   glBindVertexArray(0);
 }
 
+Mesh Mesh::icosphere(unsigned subdivisions) {
+  float t = (1.0f + sqrt(5.0f)) / 2.0f;
+  std::vector<vec3> positions = {
+    {-1, t,  0}, {1,  t,  0}, {-1, -t, 0}, {1,  -t, 0},
+    {0,  -1, t}, {0,  1,  t}, {0,  -1, -t}, {0,  1,  -t},
+    {t,  0,  -1}, {t,  0,  1}, {-t, 0,  -1}, {-t, 0,  1}
+  };
+  std::vector<unsigned> indices = {
+    0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+    1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+    3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+    4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1
+  };
+  for (auto &position: positions) position = normalize(position);
+
+  // Split every triangle in four, midpoints shared between neighbouring triangles are only added once
+  for (unsigned level = 0; level < subdivisions; level++) {
+    std::map<std::pair<unsigned, unsigned>, unsigned> midpoints;
+    auto midpoint = [&](unsigned a, unsigned b) {
+      auto key = std::make_pair(min(a, b), max(a, b));
+      auto it = midpoints.find(key);
+      if (it != midpoints.end()) return it->second;
+
+      positions.push_back(normalize(positions[a] + positions[b]));
+      return midpoints[key] = (unsigned) positions.size() - 1;
+    };
+
+    std::vector<unsigned> split;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      unsigned a = indices[i], b = indices[i + 1], c = indices[i + 2];
+      unsigned ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+      split.insert(split.end(), {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca});
+    }
+    indices = std::move(split);
+  }
+
+  // Vertices lie on the unit sphere, so faces cut inside it. Push them out until the closest face plane
+  // touches the sphere, and make every face wind counter-clockwise seen from outside.
+  float inradius = 1.0f;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    vec3 a = positions[indices[i]], b = positions[indices[i + 1]], c = positions[indices[i + 2]];
+    vec3 normal = normalize(cross(b - a, c - a));
+    if (dot(normal, a) < 0.0f) std::swap(indices[i + 1], indices[i + 2]);
+    inradius = min(inradius, abs(dot(normal, a)));
+  }
+
+  std::vector<Vertex> vertices;
+  for (const auto &position: positions) vertices.push_back({position / inradius, position, vec3(), vec2()});
+  return Mesh(std::move(vertices), std::move(indices), std::vector<Texture>());
+}
+
 void Mesh::bind_textures(const Program &program) const {
   unsigned diffuse = 0, specular = 0, normal = 0;
 
@@ -105,9 +157,22 @@ void Mesh::bind_textures(const Program &program) const {
   }
 }
 
+void Mesh::draw_elements(unsigned int instance_count) const {
+  RenderStats::current().vao_binds++;
+  RenderStats::draw(vertex_count / 3, instance_count);
+  glBindVertexArray(vao);
+  if (instance_count == 1)
+    glDrawElements(GL_TRIANGLES, vertex_count, GL_UNSIGNED_INT, 0); // NOLINT(*)
+  else
+    glDrawElementsInstanced(GL_TRIANGLES, vertex_count, GL_UNSIGNED_INT, 0, instance_count); // NOLINT(*)
+  glBindVertexArray(0);
+}
+
 void Mesh::draw(const Program &program) const {
   bind_textures(program);
 
+  RenderStats::current().vao_binds++;
+  RenderStats::draw(vertex_count / 3, 1);
   glBindVertexArray(vao);
   glDrawElements(GL_TRIANGLES, vertex_count, GL_UNSIGNED_INT, 0); // NOLINT(*)
   glBindVertexArray(0);
@@ -116,6 +181,8 @@ void Mesh::draw(const Program &program) const {
 void Mesh::draw_instanced(const Program &program, unsigned int count) const {
   bind_textures(program);
 
+  RenderStats::current().vao_binds++;
+  RenderStats::draw(vertex_count / 3, count);
   glBindVertexArray(vao);
   glDrawElementsInstanced(GL_TRIANGLES, vertex_count, GL_UNSIGNED_INT, 0, count); // NOLINT(*)
   glBindVertexArray(0);
@@ -1,6 +1,8 @@
 #include <model.h>
+#include <trace.h>
 
 Model::Model(const std::string &file_path, bool flip_normals) : flip_normals(flip_normals) {
+  TRACE_ZONE("Model load");
   Assimp::Importer importer;
   const aiScene *scene = importer.ReadFile(
     file_path,
@@ -45,6 +47,8 @@ Mesh Model::process_mesh(const aiMesh *mesh, const aiScene *scene) {
       vec2(0.0f, 0.0f)
     };
 
+    _bounds.expand(vertex.position);
+
     if (flip_normals) {
       vertex.normal *= -1.0f;
       vertex.tangent *= -1.0f;
@@ -115,6 +119,10 @@ void Model::load_texture(const std::string &path, Texture::Type type, std::vecto
   }
 }
 
+const AABB &Model::bounds() const {
+  return _bounds;
+}
+
 void Model::draw(const Program &program) const {
   program.use();
 
@@ -126,6 +134,15 @@ void Model::draw(const Program &program) const {
   for (const auto &mesh: meshes) mesh.draw(program);
 }
 
+void Model::record(CommandList &list) const {
+  list.set_cull_face(cull_backfaces);
+
+  for (const auto &mesh: meshes) {
+    list.bind_material(mesh);
+    list.draw(mesh);
+  }
+}
+
 void Model::set_instance_attribute(unsigned int location, const std::vector<mat4> &data) const {
   unsigned buf;
   glGenBuffers(1, &buf);
@@ -1,9 +1,17 @@
 #include <postprocess.h>
+#include <trace.h>
 
-PostProcessing::PostProcessing(int width, int height, Program &final_stage)
-  : final_stage(final_stage), viewport_width(width), viewport_height(height) {
-  framebuffers[0] = std::make_unique<TextureFramebuffer>(TextureFramebuffer(width, height));
-  framebuffers[1] = std::make_unique<TextureFramebuffer>(TextureFramebuffer(width, height));
+#include <algorithm>
+#include <cmath>
+
+PostProcessing::PostProcessing(int width, int height, const std::string &tonemapper, DepthAttachment input_depth)
+  : input_depth(input_depth), viewport_width(width), viewport_height(height), output_width(width),
+    output_height(height), tonemapper(tonemapper), primitives(GL_PRIMITIVES_GENERATED) {
+  resize_framebuffers(width, height);
+
+  Shader pp_vertex = Shader::vertex("shaders/common/postprocess/vert.glsl");
+  bilinear_program = Program(pp_vertex, Shader::fragment("shaders/common/postprocess/frag_tm_none.glsl"));
+  edge_program = Program(pp_vertex, Shader::fragment("shaders/common/postprocess/frag_upscale_edge.glsl"));
 
   std::vector<Vertex> quad_vertices = {
     {vec3(-1.0f, 1.0f, 0.0f),  vec3(), vec3(), vec2(0.0f, 1.0f)},
@@ -19,61 +27,217 @@ PostProcessing::PostProcessing(int width, int height, Program &final_stage)
 }
 
 void PostProcessing::resize_framebuffers(int width, int height) {
-  framebuffers[0]->free();
-  framebuffers[1]->free();
+  output_width = width;
+  output_height = height;
+  allocate_input();
+}
+
+void PostProcessing::allocate_input() {
+  int width = std::max((int) std::lround((float) output_width * _render_scale), 1);
+  int height = std::max((int) std::lround((float) output_height * _render_scale), 1);
+  if (input && width == viewport_width && height == viewport_height) return;
 
-  framebuffers[0] = std::make_unique<TextureFramebuffer>(TextureFramebuffer(width, height));
-  framebuffers[1] = std::make_unique<TextureFramebuffer>(TextureFramebuffer(width, height));
+  if (input) pool.release(*input);
+  input = &pool.acquire({width, height, {GL_RGB16F}, input_depth});
 
   viewport_width = width;
   viewport_height = height;
 }
 
+void PostProcessing::set_render_scale(float scale) {
+  _render_scale = scale;
+  allocate_input();
+}
+
+float PostProcessing::render_scale() const {
+  return _render_scale;
+}
+
+int PostProcessing::render_width() const {
+  return viewport_width;
+}
+
+int PostProcessing::render_height() const {
+  return viewport_height;
+}
+
+void PostProcessing::set_upscaler(Upscaler upscaler) {
+  _upscaler = upscaler;
+}
+
+Upscaler PostProcessing::upscaler() const {
+  return _upscaler;
+}
+
+void PostProcessing::request_resize(int width, int height) {
+  resize_debouncer.request(width, height);
+}
+
+void PostProcessing::apply_pending_resize() {
+  int width, height;
+  if (resize_debouncer.poll(width, height)) resize_framebuffers(width, height);
+}
+
+unsigned PostProcessing::input_framebuffer() {
+  apply_pending_resize();
+  return input->id();
+}
+
+unsigned PostProcessing::input_texture() {
+  apply_pending_resize();
+  return input->texture();
+}
+
+void PostProcessing::bind_input_framebuffer() {
+  apply_pending_resize();
+  input->bind();
+}
+
+const RenderTargetPool &PostProcessing::targets() const {
+  return pool;
+}
+
+// Stage fusion
+// --------------------------------------------
+
+const Program &PostProcessing::fused_program(const std::vector<std::string> &sources) {
+  std::string key;
+  for (const auto &source: sources) key += source + "\n";
+  auto it = fused_programs.find(key);
+  if (it != fused_programs.end()) return it->second;
+
+  // Each stage's STAGE function gets its own name, APPLY_STAGES chains them
+  std::string defines, apply = "#define APPLY_STAGES(color)";
+  for (size_t i = 0; i < sources.size(); i++) {
+    std::string name = "stage" + std::to_string(i);
+    defines += "#define STAGE " + name + "\n" + Shader::read_source(sources[i].c_str()) + "\n#undef STAGE\n";
+    apply += " color = " + name + "(color, texCoord);";
+  }
+  defines += apply + "\n";
+
+  Program program(
+    Shader::vertex("shaders/common/postprocess/vert.glsl"),
+    Shader::fragment("shaders/common/postprocess/frag_pointwise.glsl", defines)
+  );
+  program.use();
+  for (const auto &[name, unit]: samplers) program.set(name.c_str(), unit);
+  return fused_programs.emplace(key, program).first->second;
+}
+
+void PostProcessing::build_plan() {
+  plan.clear();
+  std::vector<std::string> run_sources;
+  for (size_t i = 0; i < stages.size(); i++) {
+    if (!stages[i].pointwise.empty()) {
+      run_sources.push_back(stages[i].pointwise);
+      continue;
+    }
+    if (!run_sources.empty()) plan.push_back({&fused_program(run_sources), 0});
+    run_sources.clear();
+    plan.push_back({nullptr, i});
+  }
+
+  run_sources.push_back(tonemapper);
+  final_program = &fused_program(run_sources);
+  plan_dirty = false;
+}
+
+void PostProcessing::set_tonemapper(const std::string &source) {
+  tonemapper = source;
+  plan_dirty = true;
+}
+
+std::vector<const Program *> PostProcessing::pointwise_programs(const std::string &source) {
+  if (plan_dirty) build_plan();
 
-unsigned PostProcessing::input_framebuffer() const {
-  return framebuffers[0]->id();
+  std::vector<const Program *> programs;
+  for (const auto &[key, program]: fused_programs) {
+    if (("\n" + key).find("\n" + source + "\n") != std::string::npos) programs.push_back(&program);
+  }
+  return programs;
 }
 
-void PostProcessing::bind_input_framebuffer() const {
-  framebuffers[0]->bind();
+double PostProcessing::fullscreen_passes() const {
+  return primitives.average_count() / 2.0;
 }
 
+// Execution
+// --------------------------------------------
+
 void PostProcessing::run() {
+  TRACE_ZONE("PostProcessing::run");
+  if (plan_dirty) build_plan();
+
+  primitives.begin();
   glDisable(GL_DEPTH_TEST);
   glEnable(GL_FRAMEBUFFER_SRGB);
+  glViewport(0, 0, viewport_width, viewport_height);
 
-  read_fb = 0;
-  for (const auto &stage: stages) {
-    stage(read_buffer(), write_buffer(), viewport_width, viewport_height, *screen_quad);
-    swap_buffers();
+  // Every pass below covers the whole target, so none of them clears it first
+  TextureFramebuffer &scratch = pool.acquire({viewport_width, viewport_height, {GL_RGB16F}});
+  TextureFramebuffer *read_buffer = input, *write_buffer = &scratch;
+  for (const auto &pass: plan) {
+    if (pass.program) {
+      write_buffer->bind();
+      pass.program->use();
+      read_buffer->bind_texture(0);
+      screen_quad->draw(*pass.program);
+    } else {
+      const Stage &stage = stages[pass.stage];
+      stage.run(*read_buffer, *write_buffer, viewport_width, viewport_height, *screen_quad, pool);
+      if (stage.analysis) continue;
+    }
+    std::swap(read_buffer, write_buffer);
   }
 
-  // Final stage
-  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-  glClear(GL_COLOR_BUFFER_BIT);
-  final_stage.use();
-  final_stage.set("screenWidth", viewport_width);
-  final_stage.set("screenHeight", viewport_height);
-  read_buffer().bind_texture();
-  screen_quad->draw(final_stage);
+  // Upscale, still in linear HDR
+  TextureFramebuffer *upscaled = nullptr;
+  glViewport(0, 0, output_width, output_height);
+  if (viewport_width != output_width || viewport_height != output_height) {
+    upscaled = &pool.acquire({output_width, output_height, {GL_RGB16F}});
+    upscaled->bind();
+    const Program &program = _upscaler == Upscaler::EdgeAware ? edge_program : bilinear_program;
+    program.use();
+    read_buffer->bind_texture();
+    screen_quad->draw(program);
+    read_buffer = upscaled;
+  }
+
+  // Final pass: trailing pointwise stages and the tonemapper
+  Framebuffer::unbind();
+  final_program->use();
+  read_buffer->bind_texture();
+  screen_quad->draw(*final_program);
   glEnable(GL_DEPTH_TEST);
   glDisable(GL_FRAMEBUFFER_SRGB);
+  primitives.end();
+
+  pool.release(scratch);
+  if (upscaled) pool.release(*upscaled);
+  pool.end_frame();
 }
 
-TextureFramebuffer &PostProcessing::read_buffer() const {
-  return *framebuffers[read_fb];
+void PostProcessing::add_stage(const PostProcessingStage &stage) {
+  stages.push_back({stage, "", false});
+  plan_dirty = true;
 }
 
-TextureFramebuffer &PostProcessing::write_buffer() const {
-  return *framebuffers[1 - read_fb];
+void PostProcessing::add_analysis_stage(const PostProcessingStage &stage) {
+  stages.push_back({stage, "", true});
+  plan_dirty = true;
 }
 
-void PostProcessing::swap_buffers() {
-  read_fb = 1 - read_fb;
+void PostProcessing::add_pointwise_stage(const std::string &source) {
+  stages.push_back({nullptr, source, false});
+  plan_dirty = true;
 }
 
-void PostProcessing::add_stage(const PostProcessingStage &stage) {
-  stages.push_back(stage);
+void PostProcessing::set_sampler(const std::string &name, int texture_unit) {
+  samplers[name] = texture_unit;
+  for (const auto &[key, program]: fused_programs) {
+    program.use();
+    program.set(name.c_str(), texture_unit);
+  }
 }
 
 PostProcessingStage make_shader_stage(const Program &program) {
@@ -82,11 +246,10 @@ PostProcessingStage make_shader_stage(const Program &program) {
     Framebuffer &write_buffer,
     int vw,
     int vh,
-    const Mesh &screen_quad
+    const Mesh &screen_quad,
+    RenderTargetPool &pool
   ) {
     write_buffer.bind();
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
     program.use();
     program.set("screenWidth", vw);
     program.set("screenHeight", vh);
@@ -0,0 +1,98 @@
+#include <postprocess/auto_exposure.h>
+
+#include <cmath>
+#include <functional>
+
+PostProcessAutoExposure::PostProcessAutoExposure(float key, float speed)
+  : luminance(LUMINANCE_SIZE, LUMINANCE_SIZE, {GL_R16F}, DepthAttachment::None),
+    adapted{
+      TextureFramebuffer(1, 1, {GL_RG32F}, DepthAttachment::None),
+      TextureFramebuffer(1, 1, {GL_RG32F}, DepthAttachment::None)
+    },
+    speed(speed) {
+  Shader pp_vertex = Shader::vertex("shaders/common/postprocess/vert.glsl");
+  luminance_program = Program(pp_vertex, Shader::fragment("shaders/common/postprocess/frag_log_luminance.glsl"));
+  adapt_program = Program(pp_vertex, Shader::fragment("shaders/common/postprocess/frag_exposure_adapt.glsl"));
+
+  luminance_program.use();
+  luminance_program.set("targetSize", vec2((float) LUMINANCE_SIZE));
+  adapt_program.use();
+  adapt_program.set("luminanceTexture", 0);
+  adapt_program.set("previousTexture", 1);
+  adapt_program.set("topLevel", (int) std::log2(LUMINANCE_SIZE));
+  set_key(key);
+
+  // Allocate the mip chain once, the reduction regenerates it every frame
+  glBindTexture(GL_TEXTURE_2D, luminance.texture());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // The first frame takes the measured luminance as is, but mixing with garbage could still give NaN
+  for (const auto &target: adapted) {
+    target.bind();
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+  }
+  Framebuffer::unbind();
+}
+
+void PostProcessAutoExposure::set_key(float key) {
+  adapt_program.use();
+  adapt_program.set("exposureKey", key);
+}
+
+void PostProcessAutoExposure::add_to(PostProcessing &post_processing) {
+  post_processing.add_analysis_stage(std::ref(*this));
+  post_processing.add_pointwise_stage("shaders/common/postprocess/pointwise/auto_exposure.glsl");
+  post_processing.set_sampler("exposureTexture", texture_unit);
+}
+
+unsigned PostProcessAutoExposure::exposure_texture() const {
+  return adapted[current].texture();
+}
+
+void PostProcessAutoExposure::operator()(
+  TextureFramebuffer &read_buffer,
+  TextureFramebuffer &write_buffer,
+  int viewport_width,
+  int viewport_height,
+  const Mesh &screen_quad,
+  RenderTargetPool &pool
+) {
+  auto now = std::chrono::steady_clock::now();
+  std::chrono::duration<float> dt = now - last_run;
+  float adaptation = first_run ? 1.0f : 1.0f - std::exp(-dt.count() * speed);
+  last_run = now;
+  first_run = false;
+
+  // Log luminance, averaged by the mipmaps
+  luminance.bind();
+  glViewport(0, 0, LUMINANCE_SIZE, LUMINANCE_SIZE);
+  luminance_program.use();
+  read_buffer.bind_texture();
+  screen_quad.draw(luminance_program);
+  luminance.bind_texture(0);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  // Adaptation, from last frame's texel into the other one
+  unsigned previous = current;
+  current = 1 - current;
+  adapted[current].bind();
+  glViewport(0, 0, 1, 1);
+  adapt_program.use();
+  adapt_program.set("adaptation", adaptation);
+  luminance.bind_texture(0);
+  adapted[previous].bind_texture(1);
+  screen_quad.draw(adapt_program);
+
+  adapted[current].bind_texture(texture_unit);
+  glActiveTexture(GL_TEXTURE0);
+  Framebuffer::unbind();
+  glViewport(0, 0, viewport_width, viewport_height);
+}
+
+void PostProcessAutoExposure::free() {
+  luminance.free();
+  for (auto &target: adapted) target.free();
+}
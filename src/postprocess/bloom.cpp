@@ -1,23 +1,69 @@
 #include <postprocess/bloom.h>
 
-PostProcessBloom::PostProcessBloom(int width, int height, unsigned iterations)
-  : width(width), height(height), iterations(iterations), internal_buffer(width, height) {
+#include <algorithm>
+
+#include <gaussian_kernel.h>
+#include <gl_compute.h>
+
+PostProcessBloom::PostProcessBloom(unsigned mips, unsigned iterations)
+  : mips(mips), iterations(iterations) {
   Shader pp_vertex = Shader::vertex("shaders/common/postprocess/vert.glsl");
 
   Shader pp_bloom = Shader::fragment("shaders/common/postprocess/frag_bloom.glsl");
   bloom_program = Program(pp_vertex, pp_bloom);
 
-  Shader pp_blur_h = Shader::fragment("shaders/common/postprocess/frag_blur_h.glsl");
-  Shader pp_blur_v = Shader::fragment("shaders/common/postprocess/frag_blur_v.glsl");
-  blur_program_h = Program(pp_vertex, pp_blur_h);
-  blur_program_v = Program(pp_vertex, pp_blur_v);
+  // Same kernel as the fixed 9-tap blur this used to have, in 5 fetches
+  GaussianKernel kernel(1.75f, 4);
+  Shader pp_blur = Shader::fragment("shaders/common/postprocess/frag_blur.glsl", kernel.defines());
+  blur_program_h = Program(pp_vertex, pp_blur);
+  blur_program_v = Program(pp_vertex, pp_blur);
+  blur_program_h.use();
+  blur_program_h.set("direction", vec2(1.0f, 0.0f));
+  blur_program_v.use();
+  blur_program_v.set("direction", vec2(0.0f, 1.0f));
 
   Shader pp_add = Shader::fragment("shaders/common/postprocess/frag_bloom_add.glsl");
   add_program = Program(pp_vertex, pp_add);
 
+  Shader pp_down = Shader::fragment("shaders/common/postprocess/frag_bloom_down.glsl");
+  Shader pp_up = Shader::fragment("shaders/common/postprocess/frag_bloom_up.glsl");
+  down_program = Program(pp_vertex, pp_down);
+  up_program = Program(pp_vertex, pp_up);
+
   add_program.use();
   add_program.set("screenTexture", 0);
   add_program.set("bloomTexture", 1);
+
+  if (load_compute_functions()) {
+    std::string defines = kernel.defines() + "#define APRON " + std::to_string(kernel.radius()) + "\n";
+    blur_compute_program = Program(Shader::compute("shaders/common/postprocess/comp_blur.glsl", defines));
+    _compute_supported = blur_compute_program.ready();
+    if (_compute_supported) _backend = BlurBackend::Compute;
+  }
+}
+
+void PostProcessBloom::set_mode(BloomMode mode) {
+  _mode = mode;
+}
+
+BloomMode PostProcessBloom::mode() const {
+  return _mode;
+}
+
+void PostProcessBloom::set_backend(BlurBackend backend) {
+  _backend = _compute_supported ? backend : BlurBackend::Fragment;
+}
+
+BlurBackend PostProcessBloom::backend() const {
+  return _backend;
+}
+
+bool PostProcessBloom::compute_supported() const {
+  return _compute_supported;
+}
+
+void PostProcessBloom::set_profiler(GpuProfiler *gpu_profiler) {
+  profiler = gpu_profiler;
 }
 
 void PostProcessBloom::operator()(
@@ -25,53 +71,152 @@ void PostProcessBloom::operator()(
   TextureFramebuffer &write_buffer,
   int viewport_width,
   int viewport_height,
-  const Mesh &screen_quad
+  const Mesh &screen_quad,
+  RenderTargetPool &pool
 ) {
-  if (width != viewport_width || height != viewport_height) {
-    width = viewport_width;
-    height = viewport_height;
-
-    internal_buffer.free();
-    internal_buffer = TextureFramebuffer(width, height);
+  if (profiler) profiler->begin_zone("bloom");
+  if (_mode == BloomMode::MipChain) {
+    mip_chain(read_buffer, write_buffer, viewport_width, viewport_height, screen_quad, pool);
+  } else {
+    blur(read_buffer, write_buffer, viewport_width, viewport_height, screen_quad, pool);
   }
+  if (profiler) profiler->end_zone();
+}
+
+void PostProcessBloom::blur(
+  TextureFramebuffer &read_buffer,
+  TextureFramebuffer &write_buffer,
+  int viewport_width,
+  int viewport_height,
+  const Mesh &screen_quad,
+  RenderTargetPool &pool
+) {
+  // Images can't be RGB16F, the compute backend writes RGBA16F
+  bool compute = _backend == BlurBackend::Compute;
+  GLint format = compute ? GL_RGBA16F : GL_RGB16F;
+  TextureFramebuffer &internal_buffer = pool.acquire({viewport_width, viewport_height, {format}});
 
   internal_buffer.bind();
-  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-  glClear(GL_COLOR_BUFFER_BIT);
   bloom_program.use();
   bloom_program.set("screenWidth", viewport_width);
   bloom_program.set("screenHeight", viewport_height);
   read_buffer.bind_texture();
   screen_quad.draw(bloom_program);
 
+  TextureFramebuffer *blurred = &internal_buffer, *compute_scratch = nullptr;
+  if (compute) {
+    compute_scratch = &pool.acquire({viewport_width, viewport_height, {GL_RGBA16F}});
+    blurred = &compute_blur(internal_buffer, *compute_scratch, viewport_width, viewport_height);
+  } else {
+    for (int i = 0; i < iterations; i++) {
+      write_buffer.bind();
+      blur_program_h.use();
+      blur_program_h.set("screenWidth", viewport_width);
+      blur_program_h.set("screenHeight", viewport_height);
+      internal_buffer.bind_texture();
+      screen_quad.draw(blur_program_h);
+
+      internal_buffer.bind();
+      blur_program_v.use();
+      blur_program_v.set("screenWidth", viewport_width);
+      blur_program_v.set("screenHeight", viewport_height);
+      write_buffer.bind_texture();
+      screen_quad.draw(blur_program_v);
+    }
+  }
+
+  write_buffer.bind();
+  add_program.use();
+  add_program.set("bloomStrength", 0.5f);
+  add_program.set("screenWidth", viewport_width);
+  add_program.set("screenHeight", viewport_height);
+  read_buffer.bind_texture(0);
+  blurred->bind_texture(1);
+  screen_quad.draw(add_program);
+  Framebuffer::unbind();
+
+  pool.release(internal_buffer);
+  if (compute_scratch) pool.release(*compute_scratch);
+}
+
+// Each workgroup loads a 16x16 tile plus the kernel radius around it into shared memory once and blurs
+// it both ways there, no quads rasterized and no intermediate target between the two directions
+TextureFramebuffer &PostProcessBloom::compute_blur(
+  TextureFramebuffer &buffer,
+  TextureFramebuffer &scratch,
+  int viewport_width,
+  int viewport_height
+) {
+  TextureFramebuffer *read = &buffer, *write = &scratch;
+  blur_compute_program.use();
   for (int i = 0; i < iterations; i++) {
-    write_buffer.bind();
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    blur_program_h.use();
-    blur_program_h.set("screenWidth", viewport_width);
-    blur_program_h.set("screenHeight", viewport_height);
-    internal_buffer.bind_texture();
-    screen_quad.draw(blur_program_h);
-
-    internal_buffer.bind();
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    blur_program_v.use();
-    blur_program_v.set("screenWidth", viewport_width);
-    blur_program_v.set("screenHeight", viewport_height);
-    write_buffer.bind_texture();
-    screen_quad.draw(blur_program_v);
+    read->bind_texture(0);
+    glBindImageTexture(0, write->texture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glDispatchCompute((viewport_width + 15) / 16, (viewport_height + 15) / 16, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    std::swap(read, write);
   }
+  // The pooled targets written here are rendered to as framebuffers later, this frame or the next
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+  return *read;
+}
 
+// Each level is half the size of the one above, so the whole chain costs about a third of one full
+// resolution pass. Levels are R11G11B10F, enough for bloom and half the bandwidth of RGB16F.
+void PostProcessBloom::mip_chain(
+  TextureFramebuffer &read_buffer,
+  TextureFramebuffer &write_buffer,
+  int viewport_width,
+  int viewport_height,
+  const Mesh &screen_quad,
+  RenderTargetPool &pool
+) {
+  std::vector<TextureFramebuffer *> chain;
+  std::vector<ivec2> sizes;
+  ivec2 size(viewport_width, viewport_height);
+  for (unsigned i = 0; i < mips && (size.x > 1 || size.y > 1); i++) {
+    size = max(size / 2, ivec2(1));
+    sizes.push_back(size);
+    chain.push_back(&pool.acquire({size.x, size.y, {GL_R11F_G11F_B10F}}));
+  }
+
+  // Downsample, thresholding out of the full resolution image
+  down_program.use();
+  for (size_t i = 0; i < chain.size(); i++) {
+    chain[i]->bind();
+    glViewport(0, 0, sizes[i].x, sizes[i].y);
+    down_program.set("prefilter", i == 0 ? 1 : 0);
+    if (i == 0) {
+      read_buffer.bind_texture();
+    } else {
+      chain[i - 1]->bind_texture();
+    }
+    screen_quad.draw(down_program);
+  }
+
+  // Upsample, every level adds the blurred level below it
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  up_program.use();
+  for (size_t i = chain.size(); i > 1; i--) {
+    chain[i - 2]->bind();
+    glViewport(0, 0, sizes[i - 2].x, sizes[i - 2].y);
+    chain[i - 1]->bind_texture();
+    screen_quad.draw(up_program);
+  }
+  glDisable(GL_BLEND);
+
+  // The top level holds the sum of every level, scaled back to about the strength of the blur
   write_buffer.bind();
-  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-  glClear(GL_COLOR_BUFFER_BIT);
+  glViewport(0, 0, viewport_width, viewport_height);
   add_program.use();
+  add_program.set("bloomStrength", 0.5f / (float) std::max(chain.size(), (size_t) 1));
   add_program.set("screenWidth", viewport_width);
   add_program.set("screenHeight", viewport_height);
   read_buffer.bind_texture(0);
-  internal_buffer.bind_texture(1);
+  if (!chain.empty()) chain[0]->bind_texture(1);
   screen_quad.draw(add_program);
   Framebuffer::unbind();
+
+  for (auto *level: chain) pool.release(*level);
 }
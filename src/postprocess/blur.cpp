@@ -0,0 +1,37 @@
+#include <postprocess/blur.h>
+
+PostProcessBlur::PostProcessBlur(const GaussianKernel &kernel) {
+  Shader pp_vertex = Shader::vertex("shaders/common/postprocess/vert.glsl");
+  Shader pp_blur = Shader::fragment("shaders/common/postprocess/frag_blur.glsl", kernel.defines());
+  blur_program_h = Program(pp_vertex, pp_blur);
+  blur_program_v = Program(pp_vertex, pp_blur);
+
+  blur_program_h.use();
+  blur_program_h.set("direction", vec2(1.0f, 0.0f));
+  blur_program_v.use();
+  blur_program_v.set("direction", vec2(0.0f, 1.0f));
+}
+
+void PostProcessBlur::operator()(
+  TextureFramebuffer &read_buffer,
+  TextureFramebuffer &write_buffer,
+  int viewport_width,
+  int viewport_height,
+  const Mesh &screen_quad,
+  RenderTargetPool &pool
+) {
+  TextureFramebuffer &internal_buffer = pool.acquire({viewport_width, viewport_height, {GL_RGB16F}});
+
+  internal_buffer.bind();
+  blur_program_h.use();
+  read_buffer.bind_texture();
+  screen_quad.draw(blur_program_h);
+
+  write_buffer.bind();
+  blur_program_v.use();
+  internal_buffer.bind_texture();
+  screen_quad.draw(blur_program_v);
+  Framebuffer::unbind();
+
+  pool.release(internal_buffer);
+}
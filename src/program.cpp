@@ -1,4 +1,5 @@
 #include <program.h>
+#include <render_stats.h>
 
 Program::Program() {
   _id = glCreateProgram();
@@ -18,6 +19,12 @@ Program::Program(const char *vertex_src, const char *fragment_src)
   link();
 }
 
+Program::Program(const Shader &compute_shader)
+  : Program() {
+  attach_shader(compute_shader);
+  link();
+}
+
 void Program::attach_shader(const Shader &shader) const {
   glAttachShader(_id, shader.id());
 }
@@ -41,6 +48,7 @@ bool Program::ready() const {
 }
 
 void Program::use() const {
+  RenderStats::current().program_binds++;
   glUseProgram(_id);
 }
 
@@ -53,22 +61,32 @@ unsigned Program::attrib_location(const char *name) const {
 }
 
 void Program::set(const char *name, int value) const {
+  RenderStats::current().uniform_calls++;
   glUniform1i(uniform_location(name), value);
 }
 
 void Program::set(const char *name, float value) const {
+  RenderStats::current().uniform_calls++;
   glUniform1f(uniform_location(name), value);
 }
 
 void Program::set(const char *name, vec2 value) const {
+  RenderStats::current().uniform_calls++;
   glUniform2f(uniform_location(name), value.x, value.y);
 }
 
 void Program::set(const char *name, vec3 value) const {
+  RenderStats::current().uniform_calls++;
   glUniform3f(uniform_location(name), value.x, value.y, value.z);
 }
 
+void Program::set(const char *name, const int *values, int count) const {
+  RenderStats::current().uniform_calls++;
+  glUniform1iv(uniform_location(name), count, values);
+}
+
 void Program::set_matrix(const char *name, mat4 &mat) const {
+  RenderStats::current().uniform_calls++;
   glUniformMatrix4fv(uniform_location(name), 1, GL_FALSE, value_ptr(mat));
 }
 
@@ -0,0 +1,352 @@
+#include <render_graph.h>
+#include <render_stats.h>
+
+#include <algorithm>
+#include <queue>
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph &graph, unsigned pass) : graph(graph), pass(pass) {
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::read(RenderResource resource) {
+  graph.passes[pass].reads.push_back(resource);
+  return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::write(RenderResource resource) {
+  graph.passes[pass].writes.push_back(resource);
+  return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::color(RenderResource resource) {
+  graph.passes[pass].colors.push_back(resource);
+  return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::depth(RenderResource resource) {
+  graph.passes[pass].depth = resource;
+  return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::clear(GLbitfield mask, vec4 color) {
+  graph.passes[pass].clear_mask = mask;
+  graph.passes[pass].clear_color = color;
+  return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::to_screen() {
+  graph.passes[pass].to_screen = true;
+  return *this;
+}
+
+// Declaration
+// --------------------------------------------
+
+RenderResource RenderGraph::add_resource(
+  const std::string &name,
+  const RenderTargetDesc &desc,
+  bool imported,
+  unsigned texture
+) {
+  resources.push_back({name, desc, imported, texture, -1});
+  return (RenderResource) resources.size() - 1;
+}
+
+RenderResource RenderGraph::create_texture(const std::string &name, int width, int height, GLint internal_format) {
+  return add_resource(name, {width, height, {internal_format}}, false, 0);
+}
+
+RenderResource RenderGraph::create_depth(const std::string &name, int width, int height) {
+  return add_resource(name, {width, height, {}, DepthAttachment::Texture}, false, 0);
+}
+
+RenderResource RenderGraph::import_texture(const std::string &name, unsigned texture, int width, int height) {
+  return add_resource(name, {width, height, {}}, true, texture);
+}
+
+RenderGraph::PassBuilder RenderGraph::add_pass(const std::string &name, const RenderPassFunction &execute) {
+  Pass pass;
+  pass.name = name;
+  pass.execute = execute;
+  passes.push_back(pass);
+  return {*this, (unsigned) passes.size() - 1};
+}
+
+void RenderGraph::reset() {
+  release_compiled();
+  resources.clear();
+  passes.clear();
+}
+
+// Compilation
+// --------------------------------------------
+
+// Resources whose contents the pass depends on: sampled textures, and attachments it doesn't clear
+std::vector<RenderResource> RenderGraph::inputs(const Pass &pass) const {
+  std::vector<RenderResource> result = pass.reads;
+  for (RenderResource resource: pass.colors) {
+    if (!overwrites(pass, resource)) result.push_back(resource);
+  }
+  if (pass.depth != none && !overwrites(pass, pass.depth)) result.push_back(pass.depth);
+  return result;
+}
+
+std::vector<RenderResource> RenderGraph::outputs(const Pass &pass) const {
+  std::vector<RenderResource> result = pass.writes;
+  result.insert(result.end(), pass.colors.begin(), pass.colors.end());
+  if (pass.depth != none) result.push_back(pass.depth);
+  return result;
+}
+
+bool RenderGraph::overwrites(const Pass &pass, RenderResource resource) const {
+  if (resource == pass.depth) return pass.clear_mask & GL_DEPTH_BUFFER_BIT;
+  bool attached = std::find(pass.colors.begin(), pass.colors.end(), resource) != pass.colors.end();
+  return attached && (pass.clear_mask & GL_COLOR_BUFFER_BIT);
+}
+
+// Topological order, ties broken by declaration order
+std::vector<unsigned> RenderGraph::sort_passes() const {
+  std::vector<std::vector<unsigned>> writers(resources.size());
+  for (unsigned i = 0; i < passes.size(); i++) {
+    for (RenderResource resource: outputs(passes[i])) {
+      if (writers[resource].empty() || writers[resource].back() != i) writers[resource].push_back(i);
+    }
+  }
+
+  std::vector<std::vector<unsigned>> next(passes.size());
+  std::vector<unsigned> in_degree(passes.size(), 0);
+  auto depend = [&](unsigned from, unsigned to) {
+    next[from].push_back(to);
+    in_degree[to]++;
+  };
+
+  for (const auto &chain: writers) {
+    for (size_t i = 1; i < chain.size(); i++) depend(chain[i - 1], chain[i]);
+  }
+  for (unsigned i = 0; i < passes.size(); i++) {
+    for (RenderResource resource: passes[i].reads) {
+      const auto &chain = writers[resource];
+      if (std::find(chain.begin(), chain.end(), i) != chain.end()) continue;
+      for (unsigned writer: chain) depend(writer, i);
+    }
+  }
+
+  std::priority_queue<unsigned, std::vector<unsigned>, std::greater<>> ready;
+  for (unsigned i = 0; i < passes.size(); i++) {
+    if (in_degree[i] == 0) ready.push(i);
+  }
+
+  std::vector<unsigned> order;
+  while (!ready.empty()) {
+    unsigned pass = ready.top();
+    ready.pop();
+    order.push_back(pass);
+    for (unsigned other: next[pass]) {
+      if (--in_degree[other] == 0) ready.push(other);
+    }
+  }
+
+  if (order.size() != passes.size()) std::cerr << "ERROR::RENDER_GRAPH::CYCLE\n";
+  return order;
+}
+
+int RenderGraph::take_slot(const RenderTargetDesc &desc, std::vector<int> &free_slots) {
+  for (size_t i = 0; i < free_slots.size(); i++) {
+    int slot = free_slots[i];
+    if (!(slot_descs[slot] == desc)) continue;
+    free_slots.erase(free_slots.begin() + (long) i);
+    return slot;
+  }
+
+  slots.push_back(&pool.acquire(desc));
+  slot_descs.push_back(desc);
+  return (int) slots.size() - 1;
+}
+
+void RenderGraph::release_compiled() {
+  for (auto &pass: compiled) {
+    if (pass.framebuffer) pass.framebuffer->free();
+  }
+  compiled.clear();
+
+  for (auto *slot: slots) pool.release(*slot);
+  slots.clear();
+  slot_descs.clear();
+  for (auto &resource: resources) resource.slot = -1;
+}
+
+void RenderGraph::compile() {
+  release_compiled();
+  std::vector<unsigned> order = sort_passes();
+
+  // Walk back from the passes with visible effects, keeping the writers of everything they need
+  std::vector<bool> needed(resources.size(), false), keep(passes.size(), false);
+  for (auto it = order.rbegin(); it != order.rend(); it++) {
+    const Pass &pass = passes[*it];
+    bool kept = pass.to_screen;
+    for (RenderResource resource: outputs(pass)) kept |= needed[resource] || resources[resource].imported;
+    if (!kept) continue;
+
+    keep[*it] = true;
+    for (RenderResource resource: outputs(pass)) {
+      if (overwrites(pass, resource)) needed[resource] = false;
+    }
+    for (RenderResource resource: inputs(pass)) needed[resource] = true;
+  }
+
+  std::vector<unsigned> kept_order;
+  for (unsigned pass: order) {
+    if (keep[pass]) kept_order.push_back(pass);
+  }
+
+  // Lifetimes, in kept passes
+  std::vector<int> first(resources.size(), -1), last(resources.size(), -1);
+  for (int i = 0; i < kept_order.size(); i++) {
+    const Pass &pass = passes[kept_order[i]];
+    for (const auto &used: {inputs(pass), outputs(pass)}) {
+      for (RenderResource resource: used) {
+        if (first[resource] < 0) first[resource] = i;
+        last[resource] = i;
+      }
+    }
+  }
+
+  // Assign textures: a resource takes a free texture of its size and format on first use, and gives it
+  // back after its last
+  std::vector<int> free_slots;
+  for (int i = 0; i < kept_order.size(); i++) {
+    const Pass &pass = passes[kept_order[i]];
+    CompiledPass compiled_pass;
+    compiled_pass.pass = kept_order[i];
+
+    for (RenderResource r = 0; r < resources.size(); r++) {
+      if (first[r] != i || resources[r].imported) continue;
+      resources[r].slot = take_slot(resources[r].desc, free_slots);
+
+      auto used = inputs(pass);
+      if (std::find(used.begin(), used.end(), r) != used.end()) {
+        std::cerr << "ERROR::RENDER_GRAPH::READ_BEFORE_WRITE::" << resources[r].name << " in " << pass.name << "\n";
+      }
+    }
+
+    // Sampling an attachment is a feedback loop, the pass samples a copy instead
+    bool samples_depth = std::find(pass.reads.begin(), pass.reads.end(), pass.depth) != pass.reads.end();
+    if (pass.depth != none && samples_depth) {
+      if (resources[pass.depth].imported) {
+        std::cerr << "ERROR::RENDER_GRAPH::SAMPLED_IMPORTED_DEPTH::" << pass.name << "\n";
+      } else {
+        compiled_pass.depth_copy = take_slot(resources[pass.depth].desc, free_slots);
+        free_slots.push_back(compiled_pass.depth_copy);
+      }
+    }
+
+    std::vector<unsigned> color_textures;
+    for (RenderResource resource: pass.colors) color_textures.push_back(texture(resource));
+    unsigned depth_texture = pass.depth != none ? texture(pass.depth) : 0;
+    if (!color_textures.empty() || depth_texture) {
+      compiled_pass.framebuffer = std::make_unique<AttachmentFramebuffer>(
+        AttachmentFramebuffer(color_textures, depth_texture)
+      );
+      const auto &desc = resources[pass.colors.empty() ? pass.depth : pass.colors[0]].desc;
+      compiled_pass.width = desc.width;
+      compiled_pass.height = desc.height;
+    }
+    compiled.push_back(std::move(compiled_pass));
+
+    for (RenderResource r = 0; r < resources.size(); r++) {
+      if (last[r] == i && resources[r].slot >= 0) free_slots.push_back(resources[r].slot);
+    }
+  }
+}
+
+// Execution
+// --------------------------------------------
+
+void RenderGraph::execute() {
+  for (const auto &compiled_pass: compiled) {
+    const Pass &pass = passes[compiled_pass.pass];
+    current = &compiled_pass;
+    if (profiler) profiler->begin_zone(pass.name);
+
+    if (compiled_pass.depth_copy >= 0) {
+      int w = compiled_pass.width, h = compiled_pass.height;
+      RenderStats::current().framebuffer_binds += 2;
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, slots[resources[pass.depth].slot]->id());
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, slots[compiled_pass.depth_copy]->id());
+      glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    }
+
+    if (compiled_pass.framebuffer) {
+      compiled_pass.framebuffer->bind();
+      glViewport(0, 0, compiled_pass.width, compiled_pass.height);
+    } else if (pass.to_screen) {
+      Framebuffer::unbind();
+    }
+
+    if (pass.clear_mask) {
+      vec4 c = pass.clear_color;
+      glClearColor(c.r, c.g, c.b, c.a);
+      if (pass.clear_mask & GL_DEPTH_BUFFER_BIT) glDepthMask(GL_TRUE);
+      glClear(pass.clear_mask);
+      RenderStats::current().clears++;
+    }
+
+    pass.execute(*this);
+    if (profiler) profiler->end_zone();
+  }
+
+  current = nullptr;
+  Framebuffer::unbind();
+  pool.end_frame();
+}
+
+void RenderGraph::set_profiler(GpuProfiler *gpu_profiler) {
+  profiler = gpu_profiler;
+}
+
+unsigned RenderGraph::texture(RenderResource resource) const {
+  const Resource &r = resources[resource];
+  if (r.imported) return r.texture;
+
+  int slot = r.slot;
+  if (current && current->depth_copy >= 0 && resource == passes[current->pass].depth) slot = current->depth_copy;
+  if (slot < 0) return 0;
+  return r.desc.formats.empty() ? slots[slot]->depth_texture() : slots[slot]->texture();
+}
+
+void RenderGraph::bind_texture(RenderResource resource, unsigned texture_unit) const {
+  RenderStats::current().texture_binds++;
+  glActiveTexture(GL_TEXTURE0 + texture_unit);
+  glBindTexture(GL_TEXTURE_2D, texture(resource));
+}
+
+// Stats
+// --------------------------------------------
+
+size_t RenderGraph::pass_count() const {
+  return passes.size();
+}
+
+size_t RenderGraph::culled_count() const {
+  return passes.size() - compiled.size();
+}
+
+size_t RenderGraph::transient_count() const {
+  size_t count = 0;
+  for (const auto &resource: resources) count += resource.slot >= 0;
+  return count;
+}
+
+size_t RenderGraph::texture_count() const {
+  return slots.size();
+}
+
+size_t RenderGraph::memory_bytes() const {
+  size_t bytes = 0;
+  for (const auto &desc: slot_descs) bytes += desc.bytes();
+  return bytes;
+}
+
+void RenderGraph::free() {
+  reset();
+  pool.free();
+}
@@ -0,0 +1,81 @@
+#include <render_stats.h>
+
+#include <iostream>
+
+RenderCounters &RenderCounters::operator+=(const RenderCounters &other) {
+  draw_calls += other.draw_calls;
+  instanced_draws += other.instanced_draws;
+  primitives += other.primitives;
+  program_binds += other.program_binds;
+  texture_binds += other.texture_binds;
+  vao_binds += other.vao_binds;
+  framebuffer_binds += other.framebuffer_binds;
+  uniform_calls += other.uniform_calls;
+  buffer_uploads += other.buffer_uploads;
+  upload_bytes += other.upload_bytes;
+  clears += other.clears;
+  return *this;
+}
+
+const RenderCounters &RenderStats::last_frame() {
+  return _last;
+}
+
+void RenderStats::end_frame() {
+  _last = _current;
+  _current = {};
+}
+
+void RenderStats::draw(uint64_t primitives, uint64_t instances) {
+  _current.draw_calls++;
+  if (instances != 1) _current.instanced_draws++;
+  _current.primitives += primitives * instances;
+}
+
+void RenderStats::upload(uint64_t bytes) {
+  _current.buffer_uploads++;
+  _current.upload_bytes += bytes;
+}
+
+void RenderStatsLog::open(const std::string &path, unsigned every_frames) {
+  close();
+  if (every_frames == 0) return;
+
+  out.open(path, std::ios::trunc);
+  if (!out) {
+    std::cerr << "ERROR::RENDER_STATS::FILE_OPEN_FAILED::" << path << "\n";
+    return;
+  }
+  interval = every_frames;
+  out << "frame,draw_calls,instanced_draws,primitives,program_binds,texture_binds,vao_binds,framebuffer_binds,"
+      << "uniform_calls,buffer_uploads,upload_bytes,clears\n";
+}
+
+void RenderStatsLog::close() {
+  if (out.is_open()) out.close();
+  interval = frames = 0;
+  total = {};
+}
+
+bool RenderStatsLog::is_open() const {
+  return out.is_open();
+}
+
+void RenderStatsLog::add_frame(const RenderCounters &counters) {
+  frame_number++;
+  if (!out.is_open()) return;
+
+  total += counters;
+  if (++frames < interval) return;
+
+  auto average = [&](uint64_t value) { return (double) value / frames; };
+  out << frame_number << "," << average(total.draw_calls) << "," << average(total.instanced_draws) << ","
+      << average(total.primitives) << "," << average(total.program_binds) << "," << average(total.texture_binds)
+      << "," << average(total.vao_binds) << "," << average(total.framebuffer_binds) << ","
+      << average(total.uniform_calls) << "," << average(total.buffer_uploads) << "," << average(total.upload_bytes)
+      << "," << average(total.clears) << "\n";
+  out.flush();
+
+  frames = 0;
+  total = {};
+}
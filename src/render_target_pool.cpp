@@ -0,0 +1,118 @@
+#include <render_target_pool.h>
+
+namespace {
+size_t format_bytes(GLint format) {
+  switch (format) {
+    case GL_RGBA32F:
+      return 16;
+    case GL_RGB32F:
+      return 12;
+    case GL_RGBA16F:
+    case GL_RG32F:
+      return 8;
+    case GL_RGB16F:
+      return 6;
+    case GL_RGB:
+    case GL_RGB8:
+      return 3;
+    case GL_R16F:
+      return 2;
+    default:
+      return 4;
+  }
+}
+}
+
+bool RenderTargetDesc::operator==(const RenderTargetDesc &other) const {
+  return width == other.width && height == other.height && formats == other.formats && depth == other.depth;
+}
+
+size_t RenderTargetDesc::bytes() const {
+  size_t texel = depth == DepthAttachment::None ? 0 : 4;
+  for (GLint format: formats) texel += format_bytes(format);
+  return (size_t) width * height * texel;
+}
+
+RenderTargetPool::RenderTargetPool(unsigned max_idle_frames) : max_idle_frames(max_idle_frames) {
+}
+
+TextureFramebuffer &RenderTargetPool::acquire(const RenderTargetDesc &desc) {
+  for (auto &entry: entries) {
+    if (entry.in_use || !(entry.desc == desc)) continue;
+    entry.in_use = true;
+    entry.last_used = frame;
+    return *entry.target;
+  }
+
+  auto target = std::make_unique<TextureFramebuffer>(
+    TextureFramebuffer(desc.width, desc.height, desc.formats, desc.depth)
+  );
+  entries.push_back({desc, std::move(target), true, frame});
+  _allocations++;
+  return *entries.back().target;
+}
+
+void RenderTargetPool::release(const TextureFramebuffer &target) {
+  for (auto &entry: entries) {
+    if (entry.target.get() != &target) continue;
+    entry.in_use = false;
+    entry.last_used = frame;
+    return;
+  }
+  std::cerr << "ERROR::RENDER_TARGET_POOL::RELEASE_UNKNOWN_TARGET\n";
+}
+
+void RenderTargetPool::end_frame() {
+  frame++;
+
+  for (size_t i = 0; i < entries.size();) {
+    if (!entries[i].in_use && frame - entries[i].last_used > max_idle_frames) {
+      entries[i].target->free();
+      entries[i] = std::move(entries.back());
+      entries.pop_back();
+    } else {
+      i++;
+    }
+  }
+}
+
+size_t RenderTargetPool::size() const {
+  return entries.size();
+}
+
+size_t RenderTargetPool::memory_bytes() const {
+  size_t bytes = 0;
+  for (const auto &entry: entries) bytes += entry.desc.bytes();
+  return bytes;
+}
+
+unsigned RenderTargetPool::allocations() const {
+  return _allocations;
+}
+
+void RenderTargetPool::free() {
+  for (auto &entry: entries) entry.target->free();
+  entries.clear();
+}
+
+ResizeDebouncer::ResizeDebouncer(double delay_ms) : delay_ms(delay_ms) {
+}
+
+void ResizeDebouncer::request(int new_width, int new_height) {
+  width = new_width;
+  height = new_height;
+  pending = true;
+  last_event = std::chrono::steady_clock::now();
+}
+
+bool ResizeDebouncer::poll(int &out_width, int &out_height) {
+  if (!pending) return false;
+
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - last_event;
+  if (elapsed.count() < delay_ms) return false;
+
+  pending = false;
+  out_width = width;
+  out_height = height;
+  return true;
+}
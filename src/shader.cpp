@@ -1,21 +1,14 @@
 #include <shader.h>
 
-Shader::Shader(GLenum type, const char *src_path)
-  : _type(type) {
-  std::string shader_src;
-  std::ifstream file;
-  file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-  try {
-    file.open(src_path);
-    std::stringstream ss;
+#include <gl_compute.h>
 
-    ss << file.rdbuf();
-    file.close();
+Shader::Shader(GLenum type, const char *src_path, const std::string &defines)
+  : _type(type) {
+  std::string shader_src = read_source(src_path);
 
-    shader_src = ss.str();
-  } catch (std::ifstream::failure &e) {
-    std::cerr << "ERROR::SHADER::" << get_type() << "::FILE_READ_FAILED\n";
+  if (!defines.empty()) {
+    size_t version_end = shader_src.rfind("#version", 0) == 0 ? shader_src.find('\n') + 1 : 0;
+    shader_src.insert(version_end, defines);
   }
 
   const char *shader_src_cstr = shader_src.c_str();
@@ -38,7 +31,16 @@ Shader::~Shader() {
 }
 
 std::string Shader::get_type() const {
-  return _type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "VERTEX";
+  switch (_type) {
+    case GL_FRAGMENT_SHADER:
+      return "FRAGMENT";
+    case GL_GEOMETRY_SHADER:
+      return "GEOMETRY";
+    case GL_COMPUTE_SHADER:
+      return "COMPUTE";
+    default:
+      return "VERTEX";
+  }
 }
 
 Shader Shader::vertex(const char *src_path) {
@@ -53,6 +55,32 @@ Shader Shader::fragment(const char *src_path) {
   return {GL_FRAGMENT_SHADER, src_path};
 }
 
+Shader Shader::fragment(const char *src_path, const std::string &defines) {
+  return {GL_FRAGMENT_SHADER, src_path, defines};
+}
+
+Shader Shader::compute(const char *src_path, const std::string &defines) {
+  return {GL_COMPUTE_SHADER, src_path, defines};
+}
+
+std::string Shader::read_source(const char *src_path) {
+  std::ifstream file;
+  file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+  try {
+    file.open(src_path);
+    std::stringstream ss;
+
+    ss << file.rdbuf();
+    file.close();
+
+    return ss.str();
+  } catch (std::ifstream::failure &e) {
+    std::cerr << "ERROR::SHADER::FILE_READ_FAILED::" << src_path << "\n";
+    return "";
+  }
+}
+
 unsigned Shader::id() const {
   return _id;
 }
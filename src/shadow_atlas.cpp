@@ -0,0 +1,243 @@
+#include <algorithm>
+
+#include <shadow_atlas.h>
+#include <render_stats.h>
+
+namespace {
+// Inverse of bit interleaving: even bits of a Z-order index are x, odd bits are y
+unsigned compact_bits(size_t v) {
+  v &= 0x5555555555555555;
+  v = (v | (v >> 1)) & 0x3333333333333333;
+  v = (v | (v >> 2)) & 0x0f0f0f0f0f0f0f0f;
+  v = (v | (v >> 4)) & 0x00ff00ff00ff00ff;
+  v = (v | (v >> 8)) & 0x0000ffff0000ffff;
+  v = (v | (v >> 16)) & 0x00000000ffffffff;
+  return (unsigned) v;
+}
+
+size_t tile_units(const ShadowRequest &request, int min_tile) {
+  size_t side = request.resolution / min_tile;
+  return request.faces * side * side;
+}
+}
+
+ShadowAtlas::ShadowAtlas(int size, GLint depth_format, bool static_cache, int min_tile, int max_tile)
+  : framebuffer(size, size, depth_format),
+    static_framebuffer(static_cache ? size : 1, static_cache ? size : 1, depth_format),
+    _size(size), min_tile(min_tile), max_tile(min(max_tile, size)), depth_format(depth_format),
+    static_cache(static_cache), rect_tbo(0), rect_texture(0) {
+  glGenBuffers(1, &rect_tbo);
+  glGenTextures(1, &rect_texture);
+
+  glBindBuffer(GL_TEXTURE_BUFFER, rect_tbo);
+  glBufferData(GL_TEXTURE_BUFFER, sizeof(vec4), nullptr, GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  glBindTexture(GL_TEXTURE_BUFFER, rect_texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, rect_tbo);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+int ShadowAtlas::resolution_for(float screen_size) const {
+  int resolution = min_tile;
+  while (resolution < max_tile && (float) resolution < screen_size) resolution *= 2;
+  return resolution;
+}
+
+void ShadowAtlas::invalidate(const AABB &caster_bounds) {
+  for (size_t i = 0; i < cache.size(); i++) {
+    const CachedSlot &slot = cache[i];
+    if (!slot.valid || !caster_bounds.intersects_sphere(vec3(slot.sphere), slot.sphere.w)) continue;
+
+    for (unsigned face = 0; face < SHADOW_SLOT_FACES; face++) faces[i * SHADOW_SLOT_FACES + face].dirty = true;
+  }
+}
+
+void ShadowAtlas::invalidate_all() {
+  for (auto &face: faces) face.dirty = true;
+}
+
+void ShadowAtlas::allocate(std::vector<ShadowRequest> requests, unsigned num_slots, unsigned face_budget) {
+  for (auto &request: requests) request.resolution = clamp(request.resolution, min_tile, max_tile);
+
+  // Atlas full: halve the largest tiles until everything fits or all are at the minimum size
+  size_t side = _size / min_tile, capacity = side * side;
+  while (true) {
+    size_t units = 0;
+    int largest = min_tile;
+    for (const auto &request: requests) {
+      units += tile_units(request, min_tile);
+      largest = max(largest, request.resolution);
+    }
+    if (units <= capacity || largest == min_tile) break;
+
+    for (auto &request: requests) {
+      if (request.resolution == largest) request.resolution /= 2;
+    }
+  }
+
+  // Largest first keeps every offset aligned; ties keep the caller's (importance) order
+  std::stable_sort(requests.begin(), requests.end(), [](const ShadowRequest &a, const ShadowRequest &b) {
+    return a.resolution > b.resolution;
+  });
+
+  _tiles.clear();
+  rects.assign((size_t) num_slots * SHADOW_SLOT_FACES, vec4(0.0f));
+  faces.resize((size_t) num_slots * SHADOW_SLOT_FACES);
+
+  // Slots that get no tile this frame lose their map
+  std::vector<CachedSlot> previous(num_slots);
+  std::swap(previous, cache);
+
+  std::vector<size_t> candidates;
+  std::vector<float> priorities;
+  unsigned mandatory = 0;
+
+  size_t offset = 0;
+  for (const auto &request: requests) {
+    size_t units = tile_units(request, min_tile);
+    if (offset + units > capacity || request.slot >= num_slots) continue;
+
+    // A tile that moved or changed size holds some other slot's depth
+    ivec2 first_offset = ivec2(compact_bits(offset), compact_bits(offset >> 1)) * min_tile;
+    const CachedSlot &cached = previous[request.slot];
+    bool placed = cached.valid && cached.resolution == request.resolution && cached.offset == first_offset;
+    cache[request.slot] = {request.sphere, first_offset, request.resolution, true};
+
+    for (unsigned face = 0; face < request.faces; face++) {
+      CachedFace &state = faces[request.slot * SHADOW_SLOT_FACES + face];
+      if (!placed) state.dirty = true;
+
+      // Without a static layer to restore from, dynamic casters mean redrawing everything. A face that
+      // held dynamic casters last time is redrawn once after they leave, or their shadow would stay.
+      ShadowPass pass = ShadowPass::Full;
+      if (!state.dirty && state.sphere == request.sphere) {
+        bool dynamic = request.dynamic_casters || state.had_dynamic;
+        pass = !dynamic ? ShadowPass::Cached : static_cache ? ShadowPass::Dynamic : ShadowPass::Full;
+      }
+
+      // Tiles without usable contents are always drawn, stale ones compete for the budget
+      if (pass != ShadowPass::Cached && !placed) mandatory++;
+      if (pass != ShadowPass::Cached && placed) {
+        candidates.push_back(_tiles.size());
+        priorities.push_back(max(request.importance, 1e-3f) * (float) (1 + state.age));
+      }
+
+      ivec2 cell(compact_bits(offset), compact_bits(offset >> 1));
+      ShadowTile tile{request.slot, face, cell * min_tile, request.resolution, pass, request.dynamic_casters};
+      _tiles.push_back(tile);
+
+      rects[request.slot * SHADOW_SLOT_FACES + face] = vec4(vec2(tile.offset), vec2((float) tile.size)) / (float) _size;
+      offset += units / request.faces;
+    }
+  }
+
+  // Spend what is left of the budget on the most important, longest waiting faces. Skipped faces age,
+  // so everything gets its turn eventually; until then shading uses their last contents.
+  unsigned remaining = face_budget > mandatory ? face_budget - mandatory : 0;
+  if (candidates.size() > remaining) {
+    std::vector<size_t> order(candidates.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return priorities[a] > priorities[b];
+    });
+    for (size_t i = remaining; i < order.size(); i++) _tiles[candidates[order[i]]].pass = ShadowPass::Cached;
+  }
+
+  _rendered_maps = _rendered_faces = 0;
+  unsigned last_slot = num_slots;
+  for (const auto &tile: _tiles) {
+    CachedFace &state = faces[tile.slot * SHADOW_SLOT_FACES + tile.face];
+    if (tile.pass == ShadowPass::Cached) {
+      state.age++;
+      continue;
+    }
+
+    state = {cache[tile.slot].sphere, 0, false, tile.dynamic_casters};
+    _rendered_faces++;
+    if (tile.slot != last_slot) _rendered_maps++;
+    last_slot = tile.slot;
+  }
+
+  RenderStats::upload(rects.size() * sizeof(vec4));
+  glBindBuffer(GL_TEXTURE_BUFFER, rect_tbo);
+  glBufferData(GL_TEXTURE_BUFFER, (long) (max(rects.size(), (size_t) 1) * sizeof(vec4)), nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_TEXTURE_BUFFER, 0, (long) (rects.size() * sizeof(vec4)), rects.data());
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+const std::vector<ShadowTile> &ShadowAtlas::tiles() const {
+  return _tiles;
+}
+
+unsigned ShadowAtlas::rendered_maps() const {
+  return _rendered_maps;
+}
+
+unsigned ShadowAtlas::rendered_faces() const {
+  return _rendered_faces;
+}
+
+int ShadowAtlas::size() const {
+  return _size;
+}
+
+const Framebuffer &ShadowAtlas::target() const {
+  return framebuffer;
+}
+
+unsigned ShadowAtlas::depth_map() const {
+  return framebuffer.depth_map();
+}
+
+const Framebuffer &ShadowAtlas::static_target() const {
+  return static_cache ? static_framebuffer : framebuffer;
+}
+
+void ShadowAtlas::restore_static() const {
+  if (!static_cache) return;
+
+  RenderStats::current().framebuffer_binds += 3;
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, static_framebuffer.id());
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer.id());
+  for (const auto &tile: _tiles) {
+    if (tile.pass == ShadowPass::Cached) continue;
+
+    ivec2 end = tile.offset + tile.size;
+    glBlitFramebuffer(
+      tile.offset.x, tile.offset.y, end.x, end.y,
+      tile.offset.x, tile.offset.y, end.x, end.y,
+      GL_DEPTH_BUFFER_BIT, GL_NEAREST
+    );
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowAtlas::set_compare(bool enabled) const {
+  glBindTexture(GL_TEXTURE_2D, framebuffer.depth_map());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, enabled ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, enabled ? GL_LINEAR : GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, enabled ? GL_LINEAR : GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void ShadowAtlas::bind(unsigned atlas_unit, unsigned rect_unit) const {
+  RenderStats::current().texture_binds += 2;
+  glActiveTexture(GL_TEXTURE0 + atlas_unit);
+  glBindTexture(GL_TEXTURE_2D, framebuffer.depth_map());
+  glActiveTexture(GL_TEXTURE0 + rect_unit);
+  glBindTexture(GL_TEXTURE_BUFFER, rect_texture);
+}
+
+size_t ShadowAtlas::memory_bytes() const {
+  size_t texel = depth_format == GL_DEPTH_COMPONENT16 ? 2 : 4;
+  return (size_t) _size * _size * texel * (static_cache ? 2 : 1);
+}
+
+void ShadowAtlas::free() {
+  framebuffer.free();
+  static_framebuffer.free();
+  glDeleteTextures(1, &rect_texture);
+  glDeleteBuffers(1, &rect_tbo);
+}
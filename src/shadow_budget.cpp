@@ -0,0 +1,35 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include <shadow_budget.h>
+
+ShadowBudget::ShadowBudget(unsigned max_faces, unsigned min_faces, double max_ms)
+  : max_faces(max_faces), min_faces(min_faces), max_ms(max_ms) {
+}
+
+ShadowBudget ShadowBudget::faces(unsigned count) {
+  return {count, count, 0.0};
+}
+
+ShadowBudget ShadowBudget::milliseconds(double ms, unsigned min_faces) {
+  return {UINT_MAX, min_faces, ms};
+}
+
+unsigned ShadowBudget::face_budget() const {
+  if (max_ms <= 0.0) return max_faces;
+
+  double ms_per_face = average_faces > 0.0 ? average_ms / average_faces : 0.0;
+  if (ms_per_face <= 0.0) return min_faces;
+
+  double faces = std::floor(max_ms / ms_per_face);
+  return faces >= (double) UINT_MAX ? UINT_MAX : std::max((unsigned) faces, min_faces);
+}
+
+void ShadowBudget::add_faces(unsigned faces) {
+  average_faces = average_faces == 0.0 ? faces : average_faces * 0.9 + faces * 0.1;
+}
+
+void ShadowBudget::add_time(double gpu_ms) {
+  average_ms = average_ms == 0.0 ? gpu_ms : average_ms * 0.9 + gpu_ms * 0.1;
+}
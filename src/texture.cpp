@@ -4,6 +4,8 @@
 #include <iostream>
 
 #include <texture.h>
+#include <render_stats.h>
+#include <trace.h>
 
 Texture::Texture(
   const char *path,
@@ -18,7 +20,11 @@ Texture::Texture(
 
   int width, height, n_channels;
   stbi_set_flip_vertically_on_load(true);
-  unsigned char *data = stbi_load(path, &width, &height, &n_channels, 4);
+  unsigned char *data;
+  {
+    TRACE_ZONE("Texture decode");
+    data = stbi_load(path, &width, &height, &n_channels, 4);
+  }
 
   if ((load_status = (data != nullptr))) {
     glActiveTexture(GL_TEXTURE0);
@@ -62,6 +68,7 @@ Texture::Texture(
 
   load_status = 1;
   for (unsigned i = 0; i < 6 && load_status; i++) {
+    TRACE_ZONE("Texture decode");
     data[i] = stbi_load(paths[i], &width[i], &height[i], &n_channels[i], 4);
     load_status = data[i] != nullptr;
   }
@@ -106,6 +113,7 @@ bool Texture::ready() const {
 }
 
 void Texture::bind(unsigned char texture_unit) const {
+  RenderStats::current().texture_binds++;
   glActiveTexture(GL_TEXTURE0 + texture_unit);
   glBindTexture(_gl_type, _id);
 }
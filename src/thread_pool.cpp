@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include <thread_pool.h>
+#include <trace.h>
+
+ThreadPool::ThreadPool(unsigned num_threads) {
+  if (num_threads == 0) num_threads = 1;
+
+  for (unsigned i = 1; i < num_threads; i++) {
+    threads.emplace_back(&ThreadPool::worker_loop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  job_ready.notify_all();
+
+  for (auto &thread: threads) thread.join();
+}
+
+unsigned ThreadPool::size() const {
+  return (unsigned) threads.size() + 1;
+}
+
+void ThreadPool::worker_loop(unsigned worker) {
+  unsigned seen_generation = 0;
+  Trace::set_thread_name("worker " + std::to_string(worker));
+
+  while (true) {
+    std::function<void(unsigned)> current_job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      job_ready.wait(lock, [&] { return stopping || generation != seen_generation; });
+      if (stopping) return;
+
+      seen_generation = generation;
+      current_job = job;
+    }
+
+    {
+      TRACE_ZONE("ThreadPool job");
+      current_job(worker);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending--;
+    }
+    job_done.notify_one();
+  }
+}
+
+void ThreadPool::run(const std::function<void(unsigned)> &fn) {
+  if (threads.empty()) {
+    fn(0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = fn;
+    pending = (unsigned) threads.size();
+    generation++;
+  }
+  job_ready.notify_all();
+
+  {
+    TRACE_ZONE("ThreadPool job");
+    fn(0);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  job_done.wait(lock, [&] { return pending == 0; });
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t, size_t, unsigned)> &fn) {
+  unsigned n = size();
+  size_t chunk = count / n, remainder = count % n;
+
+  run([&](unsigned worker) {
+    size_t begin = worker * chunk + std::min<size_t>(worker, remainder);
+    size_t end = begin + chunk + (worker < remainder ? 1 : 0);
+    if (begin < end) fn(begin, end, worker);
+  });
+}
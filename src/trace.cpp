@@ -0,0 +1,216 @@
+#include <trace.h>
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Frames after a capture during which GPU timings of its frames still come in, past GpuProfiler latency
+#define GPU_DRAIN_FRAMES 8
+#define EVENTS_PER_THREAD 65536
+#define FRAME_TID 998
+#define GPU_TID 999
+
+namespace {
+struct CpuEvent {
+  const char *name;
+  int64_t start_ns, end_ns;
+};
+
+struct GpuEvent {
+  std::string name;
+  uint64_t frame;
+  int64_t start_ns, end_ns;
+};
+
+// Written only by its thread: the event first, then the count with release order
+struct ThreadBuffer {
+  unsigned tid;
+  std::string name;
+  std::vector<CpuEvent> events = std::vector<CpuEvent>(EVENTS_PER_THREAD);
+  std::atomic<size_t> count = 0, dropped = 0;
+};
+
+struct TraceState {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> threads;
+  std::vector<GpuEvent> gpu_events;
+  std::vector<int64_t> frame_starts;
+  std::string path;
+  unsigned requested_frames = 0, captured_frames = 0, drain_frames = 0;
+  // Frames [first_frame, end_frame) are captured
+  uint64_t frame = 0, first_frame = 0, end_frame = 0;
+  int64_t gpu_offset_ns = 0;
+};
+
+TraceState &state() {
+  static TraceState trace_state;
+  return trace_state;
+}
+
+// Registered on first use, kept after the thread exits so captures can still read it
+ThreadBuffer &thread_buffer() {
+  thread_local ThreadBuffer *buffer = [] {
+    TraceState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.threads.push_back(std::make_unique<ThreadBuffer>());
+    s.threads.back()->tid = (unsigned) s.threads.size() - 1;
+    return s.threads.back().get();
+  }();
+  return *buffer;
+}
+
+void write_string(std::ofstream &out, const std::string &value) {
+  out << '"';
+  for (char c: value) {
+    if (c == '"' || c == '\\') out << '\\';
+    out << c;
+  }
+  out << '"';
+}
+
+void write_event(std::ofstream &out, const std::string &name, int64_t start_ns, int64_t end_ns, unsigned tid) {
+  out << ",\n{\"name\":";
+  write_string(out, name);
+  out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << (double) start_ns / 1e3
+      << ",\"dur\":" << (double) (end_ns - start_ns) / 1e3 << "}";
+}
+
+void write_thread_name(std::ofstream &out, const std::string &name, unsigned tid) {
+  out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+  write_string(out, name);
+  out << "}}";
+}
+}
+
+void Trace::capture(unsigned frames, const std::string &path) {
+  TraceState &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  if (s.requested_frames || s.drain_frames || frames == 0) return;
+
+  s.requested_frames = frames;
+  s.path = path;
+}
+
+void Trace::frame() {
+  TraceState &s = state();
+  int64_t now = now_ns();
+  s.frame++;
+
+  if (capturing) {
+    if (++s.captured_frames < s.requested_frames) {
+      s.frame_starts.push_back(now);
+      return;
+    }
+    capturing = false;
+    s.requested_frames = 0;
+    s.frame_starts.push_back(now);
+    s.end_frame = s.frame;
+    s.drain_frames = GPU_DRAIN_FRAMES;
+    return;
+  }
+
+  if (s.drain_frames) {
+    if (--s.drain_frames > 0) return;
+    collecting_gpu = false;
+
+    std::ofstream out(s.path);
+    if (!out) {
+      std::cerr << "ERROR::TRACE::FILE_WRITE_FAILED::" << s.path << "\n";
+      return;
+    }
+
+    // Relative to the first frame, in microseconds
+    int64_t origin = s.frame_starts.front();
+    out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"learn_opengl\"}}";
+    write_thread_name(out, "Frames", FRAME_TID);
+    write_thread_name(out, "GPU", GPU_TID);
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    for (size_t i = 0; i + 1 < s.frame_starts.size(); i++) {
+      int64_t start = s.frame_starts[i] - origin, end = s.frame_starts[i + 1] - origin;
+      write_event(out, "Frame " + std::to_string(i), start, end, FRAME_TID);
+    }
+    size_t dropped = 0;
+    for (const auto &thread: s.threads) {
+      std::string name = thread->name.empty() ? "thread " + std::to_string(thread->tid) : thread->name;
+      write_thread_name(out, name, thread->tid);
+      size_t count = thread->count.load(std::memory_order_acquire);
+      for (size_t i = 0; i < count; i++) {
+        const CpuEvent &event = thread->events[i];
+        write_event(out, event.name, event.start_ns - origin, event.end_ns - origin, thread->tid);
+      }
+      dropped += thread->dropped.load(std::memory_order_relaxed);
+    }
+    for (const auto &event: s.gpu_events) {
+      if (event.frame < s.first_frame || event.frame >= s.end_frame) continue;
+      write_event(out, event.name, event.start_ns - origin, event.end_ns - origin, GPU_TID);
+    }
+    out << "\n]}\n";
+
+    std::cout << "Trace of " << s.frame_starts.size() - 1 << " frames written to " << s.path;
+    if (dropped) std::cout << ", " << dropped << " events dropped";
+    std::cout << "\n";
+    return;
+  }
+
+  if (!s.requested_frames) return;
+
+  // Start: workers are idle, their buffers can be reset
+  std::lock_guard<std::mutex> lock(s.mutex);
+  for (auto &thread: s.threads) {
+    thread->count.store(0, std::memory_order_relaxed);
+    thread->dropped.store(0, std::memory_order_relaxed);
+  }
+  s.gpu_events.clear();
+  s.frame_starts = {now};
+  s.first_frame = s.frame;
+  s.captured_frames = 0;
+
+  // GL_TIMESTAMP now against the CPU clock now; drift over a few seconds of capture is negligible
+  GLint64 gpu_now = 0;
+  glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+  s.gpu_offset_ns = now_ns() - gpu_now;
+
+  capturing = true;
+  collecting_gpu = true;
+}
+
+uint64_t Trace::frame_index() {
+  return state().frame;
+}
+
+void Trace::set_thread_name(const std::string &name) {
+  ThreadBuffer &buffer = thread_buffer();
+  std::lock_guard<std::mutex> lock(state().mutex);
+  buffer.name = name;
+}
+
+int64_t Trace::now_ns() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+void Trace::cpu_event(const char *name, int64_t start_ns, int64_t end_ns) {
+  ThreadBuffer &buffer = thread_buffer();
+  size_t idx = buffer.count.load(std::memory_order_relaxed);
+  if (idx == buffer.events.size()) {
+    buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  buffer.events[idx] = {name, start_ns, end_ns};
+  buffer.count.store(idx + 1, std::memory_order_release);
+}
+
+void Trace::gpu_event(const std::string &name, uint64_t frame, GLuint64 start, GLuint64 end) {
+  if (!collecting_gpu.load(std::memory_order_relaxed)) return;
+
+  TraceState &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  s.gpu_events.push_back({name, frame, (int64_t) start + s.gpu_offset_ns, (int64_t) end + s.gpu_offset_ns});
+}
@@ -1,5 +1,7 @@
 #include <window.h>
 
+#include <cstdlib>
+
 namespace {
 void framebuffer_size_callback(GLFWwindow *win, int width, int height) {
   auto window = (Window *) glfwGetWindowUserPointer(win);
@@ -89,6 +91,8 @@ Window::Window(int initial_width, int initial_height, const char *title) {
   }
 
   camera = std::make_unique<Camera>(Camera());
+  thread_pool = std::make_unique<ThreadPool>();
+  gpu_profiler = std::make_unique<GpuProfiler>();
   init_success = true;
 }
 
@@ -110,10 +114,19 @@ void Window::start() {
 
   glEnable(GL_DEPTH_TEST);
 
+  // LEARN_OPENGL_TRACE_STARTUP=n captures setup() as frame 0 (model loads, texture decodes) and the
+  // frames after it, up to n in all
+  Trace::set_thread_name("main");
+  if (const char *startup_frames = std::getenv("LEARN_OPENGL_TRACE_STARTUP")) {
+    Trace::capture((unsigned) std::strtoul(startup_frames, nullptr, 10));
+  }
+  Trace::frame();
   setup();
 
   float last_frame = 0.0f;
+  unsigned frames = 0;
   while (!glfwWindowShouldClose(glfw_window)) {
+    Trace::frame();
     current_frame = (float) glfwGetTime();
     delta_time = current_frame - last_frame;
     last_frame = current_frame;
@@ -121,7 +134,12 @@ void Window::start() {
     glfwGetFramebufferSize(glfw_window, &viewport_width, &viewport_height);
 
     process_input_sync();
+    gpu_profiler->begin_frame();
     frame();
+    gpu_profiler->end_frame();
+    if (gpu_profile_interval && ++frames % gpu_profile_interval == 0) gpu_profiler->report(std::cout);
+    RenderStats::end_frame();
+    render_stats_log.add_frame(RenderStats::last_frame());
 
     glfwSwapBuffers(glfw_window);
     glfwPollEvents();
@@ -155,3 +173,7 @@ void Window::process_input_sync() {
 float Window::aspect_ratio() const {
   return (float) viewport_width / (float) viewport_height;
 }
+
+const RenderCounters &Window::render_stats() const {
+  return RenderStats::last_frame();
+}